@@ -0,0 +1,322 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "BodyStorage.h"
+#include "Checkpoint.h"
+#include "JobSystem.h"
+#include "NBodySystem.h"
+#include "OrbitKernel.h"
+#include "SceneFile.h"
+
+namespace
+{
+	typedef void (*OrbitSolve)(const float*, const float*, const float*, const float*, const float*, float*, float*, size_t);
+
+	// Best of a few runs, to skip warm-up noise
+	template <typename Run>
+	double BestSeconds(Run run)
+	{
+		double best = 1e30;
+		for (int attempt = 0; attempt < 3; attempt++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			run();
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+		return best;
+	}
+
+	double MeasureSolve(OrbitSolve solve, BodyStorage& bodies, int frames)
+	{
+		double seconds = BestSeconds([&]() {
+			for (int frame = 0; frame < frames; frame++)
+				solve(&bodies.meanAnomaly.front(), &bodies.semiMajor.front(), &bodies.eccentricity.front(),
+					&bodies.periapsisCos.front(), &bodies.periapsisSin.front(), &bodies.x.front(), &bodies.z.front(),
+					bodies.Size());
+		});
+		return bodies.Size() * (double)frames / seconds;
+	}
+
+	void BenchmarkOrbits(std::ostream& out)
+	{
+		const size_t BodyCount = 1000000;
+		const int Frames = 20;
+
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> angles(0.0f, 360.0f);
+		std::uniform_real_distribution<float> speeds(-300.0f, 300.0f);
+		std::uniform_real_distribution<float> distances(1.0f, 100.0f);
+		std::uniform_real_distribution<float> eccentricities(0.0f, 0.7f);
+		BodyStorage bodies;
+		for (size_t i = 0; i < BodyCount; i++)
+			bodies.Add(0, distances(random), angles(random), speeds(random), 0.0f, eccentricities(random), angles(random));
+		bodies.Evaluate(0.0);
+		BodyStorage reference = bodies;
+
+		double scalar = MeasureSolve(SolveOrbitsScalar, reference, Frames);
+		double simd = MeasureSolve(SolveOrbits, bodies, Frames);
+
+		// Seeking costs the same at any time, including the double precision phase reduction
+		double evaluate = BodyCount * (double)Frames / BestSeconds([&]() {
+			for (int frame = 0; frame < Frames; frame++)
+				bodies.Evaluate(1e9 + frame);
+		});
+
+		// Both solved the same anomalies, the positions must agree
+		bodies.Evaluate(0.0);
+		float deviation = 0.0f;
+		for (size_t i = 0; i < BodyCount; i++)
+			deviation = std::max(deviation, std::fabs(bodies.x[i] - reference.x[i]) + std::fabs(bodies.z[i] - reference.z[i]));
+
+		out << "BENCH::ORBITS " << BodyCount << " bodies x " << Frames << " frames" << std::endl;
+		out << "  Kepler solve, scalar: " << scalar / 1e6 << " M bodies/s" << std::endl;
+		out << "  Kepler solve, " << OrbitKernelName() << ": " << simd / 1e6 << " M bodies/s (x" << simd / scalar
+			<< "), max deviation " << deviation << std::endl;
+		out << "  Evaluate at t = 1e9 s: " << evaluate / 1e6 << " M bodies/s" << std::endl;
+	}
+
+	// Acceleration of body i summed over every body in double precision, what the tree approximates
+	void DirectAcceleration(const std::vector<glm::vec3>& positions, const std::vector<float>& masses, size_t i,
+		float softening, double acceleration[3])
+	{
+		acceleration[0] = acceleration[1] = acceleration[2] = 0.0;
+		for (size_t j = 0; j < positions.size(); j++)
+		{
+			glm::vec3 d = positions[j] - positions[i];
+			double d2 = (double)d.x * d.x + (double)d.y * d.y + (double)d.z * d.z + (double)softening * softening;
+			double f = masses[j] / (d2 * std::sqrt(d2));
+			acceleration[0] += d.x * f;
+			acceleration[1] += d.y * f;
+			acceleration[2] += d.z * f;
+		}
+	}
+
+	// Error of the tree acceleration of body i relative to the direct sum
+	double ForceError(const NBodySystem& system, const std::vector<glm::vec3>& positions, const std::vector<float>& masses,
+		size_t i)
+	{
+		double direct[3];
+		DirectAcceleration(positions, masses, i, system.softening, direct);
+		glm::vec3 tree = system.Acceleration(i);
+		double error = std::sqrt((tree.x - direct[0]) * (tree.x - direct[0]) + (tree.y - direct[1]) * (tree.y - direct[1])
+			+ (tree.z - direct[2]) * (tree.z - direct[2]));
+		return error / std::sqrt(direct[0] * direct[0] + direct[1] * direct[1] + direct[2] * direct[2]);
+	}
+
+	void BenchmarkGravity(std::ostream& out)
+	{
+		const size_t BodyCount = 1000000;
+		const int Steps = 5;
+		const size_t Samples = 256;
+
+		// A disc of light bodies on circular orbits around a heavy centre
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		const float centralMass = 1000.0f;
+		NBodySystem system;
+		std::vector<float> masses(BodyCount, 1e-4f);
+		masses[0] = centralMass;
+		system.Add(glm::vec3(0.0f), glm::vec3(0.0f), centralMass);
+		for (size_t i = 1; i < BodyCount; i++)
+		{
+			float radius = 5.0f + 95.0f * std::sqrt(unit(random));
+			float angle = 6.2831853f * unit(random);
+			float height = (unit(random) - 0.5f) * 2.0f;
+			float speed = std::sqrt(centralMass / radius);
+			system.Add(glm::vec3(radius * std::cos(angle), height, radius * std::sin(angle)),
+				glm::vec3(-speed * std::sin(angle), 0.0f, speed * std::cos(angle)), masses[i]);
+		}
+
+		double build = 0.0, force = 0.0, total = 0.0;
+		system.Step(1.0f / 60.0f);
+		for (int step = 0; step < Steps; step++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			system.Step(1.0f / 60.0f);
+			total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			build += system.BuildMilliseconds();
+			force += system.ForceMilliseconds();
+		}
+
+		// Tree accuracy against a direct sum over every body, for a few of them
+		std::vector<glm::vec3> positions(BodyCount);
+		for (size_t i = 0; i < BodyCount; i++)
+			positions[i] = system.Position(i);
+		double worst = 0.0, mean = 0.0;
+		for (size_t s = 0; s < Samples; s++)
+		{
+			double error = ForceError(system, positions, masses, 1 + s * (BodyCount / Samples));
+			worst = std::max(worst, error);
+			mean += error / Samples;
+		}
+
+		out << "BENCH::GRAVITY " << BodyCount << " bodies, theta " << system.theta << ", "
+			<< JobSystem::Concurrency() << " threads, " << system.NodeCount() << " nodes" << std::endl;
+		out << "  tree build: " << build / Steps << " ms/step" << std::endl;
+		out << "  forces: " << force / Steps << " ms/step" << std::endl;
+		out << "  full step: " << total / Steps << " ms (" << BodyCount * Steps / (total / 1000.0) / 1e6
+			<< " M bodies/s)" << std::endl;
+		out << "  force error vs direct sum: mean " << mean * 100.0 << "%, worst " << worst * 100.0 << "%" << std::endl;
+	}
+
+	void BenchmarkScene(std::ostream& out)
+	{
+		const size_t BodyCount = 1000000;
+		const char* TextPath = "bench.scene";
+		const char* BinaryPath = "bench.scene.bin";
+
+		{
+			std::ofstream text(TextPath);
+			text << "body Sun 2 36 18 - 0 0 0 up textures/sun.jpg 0 800\n";
+			std::mt19937 random(5);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			for (size_t i = 1; i < BodyCount; i++)
+				text << "body B" << i << " .01 8 4 Sun " << 10.0f + 5.0f * unit(random) << " " << 360.0f * unit(random)
+					<< " 30 up textures/moon.jpg " << 0.1f * unit(random) << "\n";
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		bool compiled = SceneFile::Compile(TextPath, BinaryPath);
+		std::chrono::duration<double, std::milli> compile = std::chrono::steady_clock::now() - start;
+
+		// A fresh hierarchy and storage every run, so each load starts from empty containers
+		double load = 1e30;
+		size_t loaded = 0;
+		for (int attempt = 0; compiled && attempt < 3; attempt++)
+		{
+			TransformHierarchy transforms;
+			BodyStorage bodies;
+			start = std::chrono::steady_clock::now();
+			SceneFile scene;
+			if (scene.Open(BinaryPath))
+				scene.LoadBodies(transforms, bodies);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			load = std::min(load, elapsed.count());
+			loaded = bodies.Size();
+		}
+		std::remove(TextPath);
+		std::remove(BinaryPath);
+
+		out << "BENCH::SCENE " << BodyCount << " bodies" << std::endl;
+		out << "  text compile: " << compile.count() << " ms" << std::endl;
+		out << "  binary load: " << load << " ms, " << loaded << " bodies" << std::endl;
+	}
+
+	void BenchmarkCheckpoint(std::ostream& out)
+	{
+		const size_t BodyCount = 1000000;
+		const char* Path = "bench.checkpoint";
+
+		TransformHierarchy transforms;
+		BodyStorage bodies;
+		NBodySystem gravity;
+		std::mt19937 random(6);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		int sun = transforms.Add();
+		bodies.Add(sun, 0.0f, 0.0f, 0.0f, 60.0f, 0.0f, 0.0f, 800.0f);
+		gravity.Add(glm::vec3(0.0f), glm::vec3(0.0f), 800.0f);
+		for (size_t i = 1; i < BodyCount; i++)
+		{
+			float radius = 10.0f + 5.0f * unit(random);
+			float angle = 6.2831853f * unit(random);
+			bodies.Add(transforms.Add(sun), radius, angle, 30.0f, 60.0f, 0.1f * unit(random));
+			gravity.Add(glm::vec3(radius * std::cos(angle), 0.0f, radius * std::sin(angle)),
+				glm::vec3(-std::sin(angle), 0.0f, std::cos(angle)), 0.0f);
+		}
+
+		// Capture is what the simulation tick pays, the write happens on the checkpoint's own thread
+		Checkpoint checkpoint(0);
+		CheckpointControls controls = { 1000.0, 1.0f, 1.0, true };
+		auto start = std::chrono::steady_clock::now();
+		bool saved = checkpoint.Save(Path, bodies, transforms, &gravity, controls);
+		std::chrono::duration<double, std::milli> capture = std::chrono::steady_clock::now() - start;
+		while (checkpoint.Writing())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::chrono::duration<double, std::milli> write = std::chrono::steady_clock::now() - start;
+
+		double restore = 1e30;
+		for (int attempt = 0; saved && attempt < 3; attempt++)
+		{
+			start = std::chrono::steady_clock::now();
+			checkpoint.Restore(Path, bodies, transforms, gravity, controls);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			restore = std::min(restore, elapsed.count());
+		}
+		std::remove(Path);
+
+		out << "BENCH::CHECKPOINT " << BodyCount << " bodies with N-body state" << std::endl;
+		out << "  capture (blocks the tick): " << capture.count() << " ms" << std::endl;
+		out << "  written after: " << write.count() << " ms" << std::endl;
+		out << "  restore: " << restore << " ms" << std::endl;
+	}
+
+	// More bodies at one point than a group holds: they share a leaf at the finest level, which
+	// the force pass has to split into several batches of targets. Every body must still get
+	// its force within 5% of the direct sum.
+	bool CheckGravityCluster(std::ostream& out)
+	{
+		const size_t ClusterSize = 1000;
+		const size_t BodyCount = 2000;
+		const float centralMass = 1000.0f;
+
+		std::mt19937 random(8);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		NBodySystem system;
+		std::vector<float> masses(BodyCount, 1e-3f);
+		masses[0] = centralMass;
+		system.Add(glm::vec3(0.0f), glm::vec3(0.0f), centralMass);
+		for (size_t i = 1; i < BodyCount; i++)
+		{
+			bool clustered = i <= ClusterSize;
+			float radius = clustered ? 20.0f : 5.0f + 95.0f * unit(random);
+			float angle = clustered ? 0.0f : 6.2831853f * unit(random);
+			float speed = std::sqrt(centralMass / radius);
+			system.Add(glm::vec3(radius * std::cos(angle), 0.0f, radius * std::sin(angle)),
+				glm::vec3(-speed * std::sin(angle), 0.0f, speed * std::cos(angle)), masses[i]);
+		}
+		system.Step(1.0f / 60.0f);
+
+		std::vector<glm::vec3> positions(BodyCount);
+		for (size_t i = 0; i < BodyCount; i++)
+			positions[i] = system.Position(i);
+		double worst = 0.0;
+		size_t broken = 0;
+		for (size_t i = 1; i < BodyCount; i++)
+		{
+			double error = ForceError(system, positions, masses, i);
+			if (!(error <= 0.05))
+				broken++;
+			worst = std::max(worst, error);
+		}
+
+		out << "CHECK::GRAVITY_CLUSTER " << ClusterSize << " coincident bodies among " << BodyCount << ": "
+			<< (broken == 0 ? "passed" : "FAILED") << std::endl;
+		out << "  force error vs direct sum: worst " << worst * 100.0 << "%, " << broken
+			<< " bodies off by more than 5%" << std::endl;
+		return broken == 0;
+	}
+}
+
+int RunBenchmarks(std::ostream& out)
+{
+	BenchmarkOrbits(out);
+	BenchmarkGravity(out);
+	BenchmarkScene(out);
+	BenchmarkCheckpoint(out);
+	return 0;
+}
+
+int RunChecks(std::ostream& out)
+{
+	bool passed = CheckGravityCluster(out);
+	return passed ? 0 : 1;
+}
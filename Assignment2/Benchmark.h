@@ -0,0 +1,10 @@
+#pragma once
+
+#include <ostream>
+
+// Offline measurements of the simulation kernels, run with the --bench command line
+// flag. No window or GL context is created. Returns the process exit code.
+int RunBenchmarks(std::ostream& out);
+// Regression checks of the simulation kernels against reference results, run with the --check
+// command line flag. Returns the process exit code, 1 when a check failed.
+int RunChecks(std::ostream& out);
@@ -0,0 +1,182 @@
+#include "BodyStorage.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "JobSystem.h"
+#include "OrbitKernel.h"
+
+namespace
+{
+	const double TwoPi = 6.283185307179586;
+	const double DegToRad = TwoPi / 360.0;
+
+	// Bodies per job, small systems are evaluated inline
+	const size_t EvaluateGrain = 4096;
+
+	// Remainder in [0, period), also for negative times
+	inline double Wrap(double value, double period)
+	{
+		return value - period * std::floor(value / period);
+	}
+}
+
+BodyStorage::Elements BodyStorage::Convert(float bodySemiMajor, float startAngle, float speed, float bodySpinSpeed,
+	float bodyEccentricity, float periapsis)
+{
+	Elements elements;
+	elements.semiMajor = bodySemiMajor;
+	// The orbit solver only converges up to MaxOrbitEccentricity
+	elements.eccentricity = std::min(std::max(bodyEccentricity, 0.0f), MaxOrbitEccentricity);
+	elements.periapsisCos = (float)std::cos(periapsis * DegToRad);
+	elements.periapsisSin = (float)std::sin(periapsis * DegToRad);
+	elements.meanAnomalyAtEpoch = startAngle * DegToRad;
+	elements.meanMotion = speed * DegToRad;
+	elements.spinSpeed = bodySpinSpeed;
+	return elements;
+}
+
+size_t BodyStorage::Add(int bodyNode, float bodySemiMajor, float startAngle, float speed, float bodySpinSpeed,
+	float bodyEccentricity, float periapsis, float bodyMass)
+{
+	Elements elements = Convert(bodySemiMajor, startAngle, speed, bodySpinSpeed, bodyEccentricity, periapsis);
+	semiMajor.push_back(elements.semiMajor);
+	eccentricity.push_back(elements.eccentricity);
+	periapsisCos.push_back(elements.periapsisCos);
+	periapsisSin.push_back(elements.periapsisSin);
+	meanAnomalyAtEpoch.push_back(elements.meanAnomalyAtEpoch);
+	meanMotion.push_back(elements.meanMotion);
+	spinSpeed.push_back(elements.spinSpeed);
+	node.push_back(bodyNode);
+	mass.push_back(bodyMass);
+
+	meanAnomaly.push_back(0.0f);
+	x.push_back(bodySemiMajor);
+	z.push_back(0.0f);
+	spin.push_back(0.0f);
+	return semiMajor.size() - 1;
+}
+
+size_t BodyStorage::Append(size_t count, int firstNode, const float* bodySemiMajor, const float* bodyEccentricity,
+	const float* bodyPeriapsisCos, const float* bodyPeriapsisSin, const double* bodyMeanAnomalyAtEpoch,
+	const double* bodyMeanMotion, const double* bodySpinSpeed, const float* bodyMass)
+{
+	size_t first = semiMajor.size();
+	// One block copy per array
+	semiMajor.insert(semiMajor.end(), bodySemiMajor, bodySemiMajor + count);
+	eccentricity.insert(eccentricity.end(), bodyEccentricity, bodyEccentricity + count);
+	periapsisCos.insert(periapsisCos.end(), bodyPeriapsisCos, bodyPeriapsisCos + count);
+	periapsisSin.insert(periapsisSin.end(), bodyPeriapsisSin, bodyPeriapsisSin + count);
+	meanAnomalyAtEpoch.insert(meanAnomalyAtEpoch.end(), bodyMeanAnomalyAtEpoch, bodyMeanAnomalyAtEpoch + count);
+	meanMotion.insert(meanMotion.end(), bodyMeanMotion, bodyMeanMotion + count);
+	spinSpeed.insert(spinSpeed.end(), bodySpinSpeed, bodySpinSpeed + count);
+	mass.insert(mass.end(), bodyMass, bodyMass + count);
+	node.reserve(first + count);
+	for (size_t i = 0; i < count; i++)
+		node.push_back(firstNode + (int)i);
+
+	meanAnomaly.resize(first + count, 0.0f);
+	x.insert(x.end(), bodySemiMajor, bodySemiMajor + count);
+	z.resize(first + count, 0.0f);
+	spin.resize(first + count, 0.0f);
+	return first;
+}
+
+void BodyStorage::Evaluate(double t)
+{
+	if (semiMajor.empty())
+		return;
+	// The phase is reduced in double precision so it stays exact far from t = 0,
+	// the kernel then only ever sees angles in [0, 2pi)
+	JobSystem::ParallelFor(semiMajor.size(), EvaluateGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			meanAnomaly[i] = (float)Wrap(meanAnomalyAtEpoch[i] + meanMotion[i] * t, TwoPi);
+			spin[i] = (float)Wrap(spinSpeed[i] * t, 360.0);
+		}
+		SolveOrbits(&meanAnomaly[begin], &semiMajor[begin], &eccentricity[begin],
+			&periapsisCos[begin], &periapsisSin[begin], &x[begin], &z[begin], end - begin);
+	});
+}
+
+void BodyStorage::Apply(TransformHierarchy& transforms) const
+{
+	for (size_t i = 0; i < node.size(); i++)
+		transforms.SetLocal(node[i], glm::translate(glm::mat4(1.0f), glm::vec3(x[i], 0.0f, z[i])));
+}
+
+void BodyStorage::ToGravity(const TransformHierarchy& transforms, NBodySystem& system) const
+{
+	std::vector<int> bodyOfNode(transforms.Size(), -1);
+	for (size_t i = 0; i < node.size(); i++)
+		bodyOfNode[node[i]] = (int)i;
+
+	// A body moves with its focus plus its own circular velocity around it, so the focus is
+	// resolved first; bodies are visited root first by walking up to the first resolved ancestor
+	std::vector<glm::vec3> velocity(node.size());
+	std::vector<bool> resolved(node.size(), false);
+	for (size_t i = 0; i < node.size(); i++)
+	{
+		std::vector<int> chain;
+		for (int body = (int)i; body >= 0 && !resolved[body];)
+		{
+			chain.push_back(body);
+			int parent = transforms.Parent(node[body]);
+			body = parent == TransformHierarchy::NoParent ? -1 : bodyOfNode[parent];
+		}
+		for (size_t c = chain.size(); c-- > 0;)
+		{
+			int body = chain[c];
+			int parent = transforms.Parent(node[body]);
+			int focus = parent == TransformHierarchy::NoParent ? -1 : bodyOfNode[parent];
+			velocity[body] = glm::vec3(0.0f);
+			if (focus >= 0)
+			{
+				glm::vec3 offset = transforms.WorldPosition(node[body]) - transforms.WorldPosition(node[focus]);
+				float radius = std::sqrt(offset.x * offset.x + offset.z * offset.z);
+				if (radius > 0.0f)
+				{
+					// Same direction of travel as the scripted orbit
+					float speed = std::sqrt(mass[focus] / radius) * (meanMotion[body] < 0.0 ? -1.0f : 1.0f);
+					velocity[body] = velocity[focus] + glm::vec3(-offset.z, 0.0f, offset.x) * (speed / radius);
+				}
+				else
+					velocity[body] = velocity[focus];
+			}
+			resolved[body] = true;
+		}
+	}
+
+	// Without the momentum of the planets taken out the whole system drifts away
+	glm::vec3 momentum(0.0f);
+	float total = 0.0f;
+	for (size_t i = 0; i < node.size(); i++)
+	{
+		momentum = momentum + velocity[i] * mass[i];
+		total += mass[i];
+	}
+	glm::vec3 drift = total > 0.0f ? momentum / total : glm::vec3(0.0f);
+
+	system.Clear();
+	for (size_t i = 0; i < node.size(); i++)
+		system.Add(transforms.WorldPosition(node[i]), velocity[i] - drift, mass[i]);
+}
+
+void BodyStorage::ApplyGravity(const NBodySystem& system, TransformHierarchy& transforms) const
+{
+	std::vector<int> bodyOfNode(transforms.Size(), -1);
+	for (size_t i = 0; i < node.size(); i++)
+		bodyOfNode[node[i]] = (int)i;
+
+	// Local offsets from the simulated focus, the hierarchy adds them back up to the simulated positions
+	for (size_t i = 0; i < node.size(); i++)
+	{
+		glm::vec3 position = system.Position(i);
+		int parent = transforms.Parent(node[i]);
+		if (parent != TransformHierarchy::NoParent)
+			position = position - (bodyOfNode[parent] >= 0 ? system.Position(bodyOfNode[parent]) : transforms.WorldPosition(parent));
+		transforms.SetLocal(node[i], glm::translate(glm::mat4(1.0f), position));
+	}
+}
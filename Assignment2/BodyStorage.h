@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "NBodySystem.h"
+#include "TransformHierarchy.h"
+
+// Orbital elements of every body, one array per field so the orbit kernel streams
+// through them instead of chasing each body on the heap. Positions are a function
+// of time only, so any instant can be evaluated directly, past or future.
+class BodyStorage
+{
+public:
+	// Adds a body orbiting its hierarchy node's parent, returns its index.
+	// Angles are in degrees and speeds in degrees per simulated second; speed is the
+	// mean motion, so eccentric orbits still take 360 / speed seconds per revolution.
+	size_t Add(int node, float semiMajor, float startAngle, float speed, float spinSpeed,
+		float eccentricity = 0.0f, float periapsis = 0.0f, float mass = 0.0f);
+	// Appends count bodies at once from arrays laid out like the elements below, for loaders.
+	// Their nodes are firstNode, firstNode + 1, ...; returns the index of the first one.
+	size_t Append(size_t count, int firstNode, const float* semiMajor, const float* eccentricity,
+		const float* periapsisCos, const float* periapsisSin, const double* meanAnomalyAtEpoch,
+		const double* meanMotion, const double* spinSpeed, const float* mass);
+	size_t Size() const { return semiMajor.size(); }
+
+	// Elements of one body in the units they are stored in, from the arguments of Add.
+	// Loaders that fill the arrays directly convert through here too.
+	struct Elements
+	{
+		float semiMajor, eccentricity, periapsisCos, periapsisSin;
+		double meanAnomalyAtEpoch, meanMotion, spinSpeed;
+	};
+	static Elements Convert(float semiMajor, float startAngle, float speed, float spinSpeed,
+		float eccentricity = 0.0f, float periapsis = 0.0f);
+
+	// Computes every orbit offset and spin at simulated time t
+	void Evaluate(double t);
+	// Writes the offsets of the last Evaluate as the local transforms of the bodies' nodes
+	void Apply(TransformHierarchy& transforms) const;
+
+	// Loads every body into an N-body system at its current world position, moving on a
+	// circular orbit around its focus so the system starts close to the scripted motion.
+	// Body i becomes the system's body i.
+	void ToGravity(const TransformHierarchy& transforms, NBodySystem& system) const;
+	// Writes the simulated positions as the local transforms of the bodies' nodes
+	void ApplyGravity(const NBodySystem& system, TransformHierarchy& transforms) const;
+
+	// Elements
+	std::vector<float> semiMajor;           // from the focus for circular orbits
+	std::vector<float> eccentricity;        // 0 for circles
+	std::vector<float> periapsisCos, periapsisSin; // direction of the closest approach
+	std::vector<double> meanAnomalyAtEpoch; // radians at t = 0
+	std::vector<double> meanMotion;         // radians per simulated second
+	std::vector<double> spinSpeed;          // degrees per simulated second
+	std::vector<int> node;                  // transform hierarchy node, its parent is the focus
+	std::vector<float> mass;                // G * m, only used by the N-body mode
+
+	// State at the last Evaluate
+	std::vector<float> meanAnomaly;         // radians, in [0, 2pi)
+	std::vector<float> x, z;                // orbit offset in the focus' frame
+	std::vector<float> spin;                // rotation about the body's own axis, degrees
+};
@@ -0,0 +1,81 @@
+#include "BodySystems.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+const float BodySystems::SpinSpeed = 60.0f;
+
+Entity BodySystems::CreateBody(SceneRegistry& registry, TransformHierarchy& transforms, BodyStorage& bodies,
+	float radius, int sectorCount, int stackCount, Entity focus, float distance, float startAngle, float startSpeed,
+	const std::string& name, bool up, const std::string& texturePath, float eccentricity, float mass)
+{
+	int node = transforms.Add(focus != NoEntity ? registry.Get<Transform>(focus).node : TransformHierarchy::NoParent);
+	size_t body = bodies.Add(node, focus != NoEntity ? distance : 0.0f, startAngle, startSpeed, SpinSpeed,
+		eccentricity, 0.0f, mass);
+	return CreateEntity(registry, node, body, radius, MeshCache::GetSphere(sectorCount, stackCount),
+		MaterialLibrary::Load(texturePath), name, up);
+}
+
+Entity BodySystems::CreateEntity(SceneRegistry& registry, int node, size_t body, float radius,
+	const std::shared_ptr<const Mesh>& mesh, const Material& material, const std::string& name, bool up)
+{
+	Entity entity = registry.Create();
+
+	// The radius is applied here since the mesh is a unit sphere. The scale is uniform,
+	// so the spin applied on top is unaffected by it.
+	Transform transform;
+	transform.node = node;
+	transform.shape = glm::scale(
+		glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)), glm::vec3(radius));
+	registry.Add(entity, transform);
+
+	Orbit orbit = { body };
+	registry.Add(entity, orbit);
+
+	MeshRef meshRef = { mesh };
+	registry.Add(entity, meshRef);
+
+	MaterialRef materialRef = { material.texture, material.layer };
+	registry.Add(entity, materialRef);
+
+	// Unnamed bodies get no label
+	if (!name.empty())
+	{
+		Label label = { name, up };
+		registry.Add(entity, label);
+	}
+	return entity;
+}
+
+void BodySystems::SetFocus(SceneRegistry& registry, TransformHierarchy& transforms, BodyStorage& bodies, Entity entity, Entity focus)
+{
+	transforms.SetParent(registry.Get<Transform>(entity).node,
+		focus != NoEntity ? registry.Get<Transform>(focus).node : TransformHierarchy::NoParent);
+	// A body without focus stays where the hierarchy root puts it
+	if (focus == NoEntity)
+		bodies.semiMajor[registry.Get<Orbit>(entity).body] = 0.0f;
+}
+
+void BodySystems::DrawBodies(SceneRegistry& registry, SphereRenderer& renderer, const Snapshot& state, float alpha)
+{
+	registry.Each<MeshRef, MaterialRef, Transform, Orbit>(
+		[&](Entity, const MeshRef& mesh, const MaterialRef& material, const Transform& transform, const Orbit& orbit) {
+		// Nodes are only ever translated, the position is the whole world transform
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), state.Position(transform.node, alpha))
+			* glm::rotate(transform.shape, glm::radians(state.Spin(orbit.body, alpha)), glm::vec3(0.0f, 0.0f, 1.0f));
+		renderer.Submit(mesh.mesh, material.texture, model, material.layer);
+	});
+}
+
+void BodySystems::DrawLabels(SceneRegistry& registry, const glm::mat4& view, const glm::mat4& projection,
+	const glm::vec2& screenSize, Text& text, const Snapshot& state, float alpha)
+{
+	registry.Each<Label, Transform>([&](Entity, const Label& label, const Transform& transform) {
+		glm::vec4 clipSpacePos = projection * (view * glm::vec4(state.Position(transform.node, alpha), 1.0));
+		// Labels sit just above or below the orbital plane, which crosses the middle of the screen
+		float x = (clipSpacePos.x / clipSpacePos.w + 1.0f) * screenSize.x / 2 - 20;
+		float y = screenSize.y / 2 - 50;
+		if (label.up)
+			y += 80;
+		text.Render(label.text, x, y, .3f, glm::vec3(.2f, .9f, .3f));
+	});
+}
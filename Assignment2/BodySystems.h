@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "BodyStorage.h"
+#include "Components.h"
+#include "MaterialLibrary.h"
+#include "Snapshot.h"
+#include "SphereRenderer.h"
+#include "Text.h"
+#include "TransformHierarchy.h"
+
+// Creates bodies as entities and runs the systems over their components. Each system only
+// walks the pools it needs, by reference, in dense order.
+class BodySystems
+{
+public:
+	// Every body turns about its own axis at this many degrees per simulated second
+	static const float SpinSpeed;
+
+	// Adds a textured sphere orbiting focus (NoEntity for none), with the same parameters the scene
+	// always used: startSpeed is in degrees per simulated second and distance the semi-major axis,
+	// mass (G * m) only matters in N-body mode
+	static Entity CreateBody(SceneRegistry& registry, TransformHierarchy& transforms, BodyStorage& bodies,
+		float radius, int sectorCount, int stackCount, Entity focus, float distance, float startAngle, float startSpeed,
+		const std::string& name, bool up, const std::string& texturePath, float eccentricity = 0.0f, float mass = 0.0f);
+	// Creates the entity of a body already in the hierarchy and the body storage
+	static Entity CreateEntity(SceneRegistry& registry, int node, size_t body, float radius,
+		const std::shared_ptr<const Mesh>& mesh, const Material& material, const std::string& name, bool up);
+	// Makes a body orbit another one, which may have been created after it. Only before the simulation starts.
+	static void SetFocus(SceneRegistry& registry, TransformHierarchy& transforms, BodyStorage& bodies, Entity entity, Entity focus);
+
+	// Queues every body for this frame's instanced draw, from a published state blended by alpha
+	static void DrawBodies(SceneRegistry& registry, SphereRenderer& renderer, const Snapshot& state, float alpha);
+	static void DrawLabels(SceneRegistry& registry, const glm::mat4& view, const glm::mat4& projection,
+		const glm::vec2& screenSize, Text& text, const Snapshot& state, float alpha);
+private:
+	BodySystems() {}
+};
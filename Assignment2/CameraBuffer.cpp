@@ -0,0 +1,25 @@
+#include "CameraBuffer.h"
+#include "Shader.h"
+
+CameraBuffer::CameraBuffer()
+{
+	glGenBuffers(1, &UBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraData), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	// Every program binds its "Camera" block to this point when it is created
+	glBindBufferBase(GL_UNIFORM_BUFFER, Shader::CameraBlockBinding, UBO);
+}
+
+CameraBuffer::~CameraBuffer()
+{
+	glDeleteBuffers(1, &UBO);
+}
+
+void CameraBuffer::Update(const glm::mat4& view, const glm::mat4& projection, const glm::mat4& screen)
+{
+	CameraData data = { view, projection, screen };
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraData), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Mirrors the std140 "Camera" uniform block declared in main.vert.glsl and text.vert.glsl.
+// mat4 members are already 16-byte aligned, so no explicit padding is needed.
+struct CameraData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 screen; // orthographic projection in window pixels, used for text
+};
+
+// Uniform buffer holding the per-frame camera data shared by every program
+class CameraBuffer
+{
+public:
+	CameraBuffer();
+	~CameraBuffer();
+
+	// Uploads the camera data, call once per frame before drawing
+	void Update(const glm::mat4& view, const glm::mat4& projection, const glm::mat4& screen);
+private:
+	GLuint UBO;
+};
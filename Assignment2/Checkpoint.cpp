@@ -0,0 +1,208 @@
+#include "Checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "FileSections.h"
+#include "Hash.h"
+
+namespace
+{
+	const uint32_t CheckpointMagic = 0x504b4843; // "CHKP"
+	const uint32_t CheckpointVersion = 2;
+
+	struct CheckpointHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t structure;    // Checkpoint::Structure of the scene it was taken from
+		uint32_t bodyCount;
+		uint32_t gravityCount; // bodies with an N-body state, 0 or bodyCount
+		double time;
+		double timeWarp;
+		float speedScale;
+		uint32_t gravity;
+	};
+
+	// Byte offset of every section. Doubles come first.
+	struct CheckpointLayout
+	{
+		size_t meanAnomalyAtEpoch, meanMotion, spinSpeed;
+		size_t semiMajor, eccentricity, periapsisCos, periapsisSin, mass;
+		size_t position, velocity; // x, y, z of each N-body body
+		size_t size;
+	};
+
+	CheckpointLayout Layout(const CheckpointHeader& header)
+	{
+		size_t bodies = header.bodyCount;
+		FileSections sections(sizeof(CheckpointHeader));
+		CheckpointLayout layout;
+		layout.meanAnomalyAtEpoch = sections.Add<double>(bodies);
+		layout.meanMotion = sections.Add<double>(bodies);
+		layout.spinSpeed = sections.Add<double>(bodies);
+		layout.semiMajor = sections.Add<float>(bodies);
+		layout.eccentricity = sections.Add<float>(bodies);
+		layout.periapsisCos = sections.Add<float>(bodies);
+		layout.periapsisSin = sections.Add<float>(bodies);
+		layout.mass = sections.Add<float>(bodies);
+		layout.position = sections.Add<float>(header.gravityCount * 3);
+		layout.velocity = sections.Add<float>(header.gravityCount * 3);
+		layout.size = sections.Size();
+		return layout;
+	}
+}
+
+Checkpoint::Checkpoint(uint64_t sceneHash) : scene(sceneHash), writing(false)
+{
+
+}
+
+Checkpoint::~Checkpoint()
+{
+	if (writer.joinable())
+		writer.join();
+}
+
+bool Checkpoint::Save(const std::string& path, const BodyStorage& bodies, const TransformHierarchy& transforms,
+	const NBodySystem* gravity, const CheckpointControls& controls)
+{
+	if (writing)
+	{
+		std::cout << "ERROR::CHECKPOINT::BUSY still writing the previous checkpoint" << std::endl;
+		return false;
+	}
+	if (writer.joinable())
+		writer.join();
+
+	CheckpointHeader header = { CheckpointMagic, CheckpointVersion, Structure(bodies, transforms),
+		(uint32_t)bodies.Size(), gravity != nullptr ? (uint32_t)gravity->Size() : 0, controls.time, controls.timeWarp,
+		controls.speedScale, controls.gravity ? 1u : 0u };
+	CheckpointLayout layout = Layout(header);
+	// The buffer is kept between saves, only the first one allocates it
+	image.resize(layout.size);
+	memcpy(&image[0], &header, sizeof(header));
+	WriteSection(image, layout.meanAnomalyAtEpoch, bodies.meanAnomalyAtEpoch);
+	WriteSection(image, layout.meanMotion, bodies.meanMotion);
+	WriteSection(image, layout.spinSpeed, bodies.spinSpeed);
+	WriteSection(image, layout.semiMajor, bodies.semiMajor);
+	WriteSection(image, layout.eccentricity, bodies.eccentricity);
+	WriteSection(image, layout.periapsisCos, bodies.periapsisCos);
+	WriteSection(image, layout.periapsisSin, bodies.periapsisSin);
+	WriteSection(image, layout.mass, bodies.mass);
+	if (gravity != nullptr)
+	{
+		float* position = reinterpret_cast<float*>(&image[layout.position]);
+		float* velocity = reinterpret_cast<float*>(&image[layout.velocity]);
+		for (size_t i = 0; i < header.gravityCount; i++)
+		{
+			glm::vec3 p = gravity->Position(i);
+			glm::vec3 v = gravity->Velocity(i);
+			memcpy(position + i * 3, &p.x, 3 * sizeof(float));
+			memcpy(velocity + i * 3, &v.x, 3 * sizeof(float));
+		}
+	}
+
+	writing = true;
+	writer = std::thread(&Checkpoint::Write, this, path);
+	return true;
+}
+
+void Checkpoint::Write(std::string path)
+{
+	std::string temporary = path + ".tmp";
+	bool written;
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		for (size_t offset = 0; out && offset < image.size(); offset += WriteChunk)
+		{
+			size_t bytes = image.size() - offset < WriteChunk ? image.size() - offset : WriteChunk;
+			out.write(reinterpret_cast<const char*>(&image[offset]), bytes);
+		}
+		out.close();
+		written = (bool)out;
+	}
+	// rename does not replace an existing file everywhere
+	if (written)
+	{
+		std::remove(path.c_str());
+		written = std::rename(temporary.c_str(), path.c_str()) == 0;
+	}
+	if (written)
+		std::cout << "Checkpoint saved to " << path << " (" << image.size() / 1024 << " KB)" << std::endl;
+	else
+	{
+		std::cout << "ERROR::CHECKPOINT::WRITE_FAILED " << path << std::endl;
+		std::remove(temporary.c_str());
+	}
+	writing = false;
+}
+
+bool Checkpoint::Restore(const std::string& path, BodyStorage& bodies, const TransformHierarchy& transforms,
+	NBodySystem& gravity, CheckpointControls& controls) const
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		std::cout << "ERROR::CHECKPOINT::FILE_NOT_FOUND " << path << std::endl;
+		return false;
+	}
+	CheckpointHeader header;
+	bool valid = file.Size() >= sizeof(header);
+	if (valid)
+	{
+		memcpy(&header, file.Data(), sizeof(header));
+		valid = header.magic == CheckpointMagic && header.version == CheckpointVersion
+			&& (header.gravityCount == 0 || header.gravityCount == header.bodyCount)
+			&& file.Size() >= Layout(header).size;
+	}
+	if (!valid)
+	{
+		std::cout << "ERROR::CHECKPOINT::INVALID_FILE " << path << std::endl;
+		return false;
+	}
+	if (header.bodyCount != bodies.Size() || header.structure != Structure(bodies, transforms))
+	{
+		std::cout << "ERROR::CHECKPOINT::OTHER_SCENE " << path << std::endl;
+		return false;
+	}
+
+	CheckpointLayout layout = Layout(header);
+	size_t count = header.bodyCount;
+	ReadSection(file, layout.meanAnomalyAtEpoch, count, bodies.meanAnomalyAtEpoch);
+	ReadSection(file, layout.meanMotion, count, bodies.meanMotion);
+	ReadSection(file, layout.spinSpeed, count, bodies.spinSpeed);
+	ReadSection(file, layout.semiMajor, count, bodies.semiMajor);
+	ReadSection(file, layout.eccentricity, count, bodies.eccentricity);
+	ReadSection(file, layout.periapsisCos, count, bodies.periapsisCos);
+	ReadSection(file, layout.periapsisSin, count, bodies.periapsisSin);
+	ReadSection(file, layout.mass, count, bodies.mass);
+
+	gravity.Clear();
+	const float* position = SectionData<float>(file, layout.position);
+	const float* velocity = SectionData<float>(file, layout.velocity);
+	for (size_t i = 0; i < header.gravityCount; i++)
+	{
+		gravity.Add(glm::vec3(position[i * 3], position[i * 3 + 1], position[i * 3 + 2]),
+			glm::vec3(velocity[i * 3], velocity[i * 3 + 1], velocity[i * 3 + 2]), bodies.mass[i]);
+	}
+
+	controls.time = header.time;
+	controls.speedScale = header.speedScale;
+	controls.timeWarp = header.timeWarp;
+	controls.gravity = header.gravity != 0 && header.gravityCount > 0;
+	return true;
+}
+
+uint64_t Checkpoint::Structure(const BodyStorage& bodies, const TransformHierarchy& transforms) const
+{
+	uint64_t hash = Fnv1a(Fnv1aOffset, &scene, sizeof(scene));
+	for (size_t i = 0; i < bodies.Size(); i++)
+	{
+		int parent = transforms.Parent(bodies.node[i]);
+		hash = Fnv1a(hash, &parent, sizeof(parent));
+	}
+	return hash;
+}
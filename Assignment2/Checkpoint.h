@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BodyStorage.h"
+#include "NBodySystem.h"
+#include "TransformHierarchy.h"
+
+// Simulation settings saved with a checkpoint
+struct CheckpointControls
+{
+	double time;       // simulated seconds
+	float speedScale;
+	double timeWarp;
+	bool gravity;      // the N-body state was saved and is resumed
+};
+
+// Binary checkpoint of a running simulation: the elements of every body, the clock and,
+// in N-body mode, every body's position and velocity, so a long run resumes exactly where
+// it was instead of being replayed from year 0.
+// The file is laid out like SceneFile, one 8-byte aligned array per element. Saving copies
+// the state into that image with one block copy per array and writes it on a background
+// thread, so the tick only pays for the copies. Restoring maps the file and copies every
+// array straight back.
+class Checkpoint
+{
+public:
+	// sceneHash identifies the scene file the bodies were loaded from
+	explicit Checkpoint(uint64_t sceneHash);
+	// Waits for the checkpoint being written
+	~Checkpoint();
+
+	// Captures the state and starts writing it to path. gravity is null when the Kepler orbits
+	// are running. False, and nothing saved, while the previous checkpoint is still being written.
+	bool Save(const std::string& path, const BodyStorage& bodies, const TransformHierarchy& transforms,
+		const NBodySystem* gravity, const CheckpointControls& controls);
+	bool Writing() const { return writing; }
+
+	// Loads a checkpoint taken from the same scene. gravity is refilled when the checkpoint was
+	// taken in N-body mode. Nothing is changed when false is returned.
+	bool Restore(const std::string& path, BodyStorage& bodies, const TransformHierarchy& transforms,
+		NBodySystem& gravity, CheckpointControls& controls) const;
+private:
+	Checkpoint(const Checkpoint&);
+	Checkpoint& operator=(const Checkpoint&);
+
+	// Writes the image to a temporary file which then replaces the previous checkpoint, so a
+	// write cut short never leaves a broken checkpoint behind
+	void Write(std::string path);
+	// Identifies the scene the bodies come from: the hash of its file and the parent of every
+	// body, so a checkpoint is not restored over a scene that was edited or rearranged
+	uint64_t Structure(const BodyStorage& bodies, const TransformHierarchy& transforms) const;
+
+	// Bytes written at once, the writer never holds the disk for long
+	static const size_t WriteChunk = 1 << 20;
+
+	uint64_t scene;
+	std::vector<unsigned char> image;
+	std::atomic<bool> writing;
+	std::thread writer;
+};
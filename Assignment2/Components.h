@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "MeshCache.h"
+#include "Registry.h"
+
+// Place of a body in the TransformHierarchy, only translated by the orbit so moons do not
+// inherit the spin, plus the axis orientation and radius of the body itself
+struct Transform
+{
+	int node;
+	glm::mat4 shape;
+};
+
+// Orbital elements and spin of a body, stored in BodyStorage for the SIMD kernel
+struct Orbit
+{
+	size_t body;
+};
+
+// Unit sphere geometry, shared by every body with the same tessellation
+struct MeshRef
+{
+	std::shared_ptr<const Mesh> mesh;
+};
+
+// Layer of the texture array shared by the surface's resolution class
+struct MaterialRef
+{
+	GLuint texture;
+	GLfloat layer;
+};
+
+// Name shown next to the body, just above or below the orbital plane
+struct Label
+{
+	std::string text;
+	bool up;
+};
+
+typedef Registry<Transform, Orbit, MeshRef, MaterialRef, Label> SceneRegistry;
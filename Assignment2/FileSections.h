@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Layout of a binary file made of a header followed by arrays, one section per array.
+// Every section starts 8-byte aligned, so arrays of any element type can be read in
+// place from a MappedFile, and a whole section is moved with one block copy.
+class FileSections
+{
+public:
+	explicit FileSections(size_t headerBytes) : size(Align(headerBytes)) {}
+
+	// Appends a section of count elements, returns its byte offset
+	template <typename T>
+	size_t Add(size_t count)
+	{
+		size_t offset = size;
+		size = Align(size + count * sizeof(T));
+		return offset;
+	}
+	// Bytes of the whole file, padding after the last section included
+	size_t Size() const { return size; }
+private:
+	static size_t Align(size_t bytes) { return (bytes + 7) & ~(size_t)7; }
+
+	size_t size;
+};
+
+// Array of a section, straight from the mapping
+template <typename T>
+const T* SectionData(const MappedFile& file, size_t offset)
+{
+	return reinterpret_cast<const T*>(file.Data() + offset);
+}
+
+// Copies an array into its section of a file image
+template <typename T>
+void WriteSection(std::vector<unsigned char>& image, size_t offset, const std::vector<T>& data)
+{
+	if (!data.empty())
+		memcpy(&image[offset], &data.front(), data.size() * sizeof(T));
+}
+
+// Replaces an array with the count elements of its section
+template <typename T>
+void ReadSection(const MappedFile& file, size_t offset, size_t count, std::vector<T>& data)
+{
+	const T* first = SectionData<T>(file, offset);
+	data.assign(first, first + count);
+}
@@ -0,0 +1,294 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class JobSystem::Counter
+{
+public:
+	explicit Counter(int jobs) : pending(jobs), done(false) {}
+
+	struct Task;
+	std::atomic<int> pending;                   // jobs still to finish
+	std::mutex lock;
+	bool done;                                  // set under lock, after which nothing is added to waiting
+	std::vector<std::shared_ptr<Task>> waiting; // jobs that depend on this counter
+};
+
+struct JobSystem::Counter::Task
+{
+	std::function<void()> run;
+	Handle counter;
+	std::atomic<int> dependencies;              // handles still to finish before the job can be queued
+};
+
+namespace
+{
+	typedef std::shared_ptr<JobSystem::Counter::Task> TaskPtr;
+
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<TaskPtr> tasks;
+	};
+
+	// Queue 0 is shared by every thread outside the pool, worker i owns queue i
+	std::vector<std::unique_ptr<Queue>> Queues;
+	std::vector<std::thread> Workers;
+	std::mutex PoolLock;
+	std::atomic<bool> Started(false);
+	bool Stopping = false;
+
+	// Sleeping workers and waiting threads are woken when queued goes up, waiting threads also
+	// when a counter finishes
+	std::atomic<int> Queued(0);
+	std::mutex SleepLock;
+	std::condition_variable Wake;
+
+	thread_local size_t CurrentQueue = 0;
+
+	// Joins the workers at exit if Shutdown was never called, joinable threads would terminate
+	struct PoolGuard
+	{
+		~PoolGuard() { JobSystem::Shutdown(); }
+	} Guard;
+
+	void Push(const TaskPtr& task)
+	{
+		Queue& queue = *Queues[CurrentQueue];
+		{
+			std::lock_guard<std::mutex> guard(queue.lock);
+			queue.tasks.push_back(task);
+		}
+		Queued++;
+		// Taking the lock orders the increment before a worker's check of the predicate
+		{
+			std::lock_guard<std::mutex> guard(SleepLock);
+		}
+		Wake.notify_one();
+	}
+
+	// Newest job of the own queue, otherwise the oldest job of the next queue that has one
+	bool Take(TaskPtr& task)
+	{
+		size_t count = Queues.size();
+		for (size_t n = 0; n < count; n++)
+		{
+			Queue& queue = *Queues[(CurrentQueue + n) % count];
+			std::lock_guard<std::mutex> guard(queue.lock);
+			if (queue.tasks.empty())
+				continue;
+			if (n == 0)
+			{
+				task = queue.tasks.back();
+				queue.tasks.pop_back();
+			}
+			else
+			{
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+			}
+			Queued--;
+			return true;
+		}
+		return false;
+	}
+
+	void Release(const TaskPtr& task)
+	{
+		if (--task->dependencies == 0)
+			Push(task);
+	}
+
+	void Execute(const TaskPtr& task)
+	{
+		task->run();
+		JobSystem::Counter& counter = *task->counter;
+		if (--counter.pending > 0)
+			return;
+		std::vector<TaskPtr> ready;
+		{
+			std::lock_guard<std::mutex> guard(counter.lock);
+			counter.done = true;
+			ready.swap(counter.waiting);
+		}
+		for (auto& next : ready)
+			Release(next);
+		// As in Push, the lock orders the decrement before a waiting thread's check of the predicate
+		{
+			std::lock_guard<std::mutex> guard(SleepLock);
+		}
+		Wake.notify_all();
+	}
+
+	void WorkerLoop(size_t queue)
+	{
+		CurrentQueue = queue;
+		TaskPtr task;
+		while (true)
+		{
+			if (Take(task))
+			{
+				Execute(task);
+				task.reset();
+				continue;
+			}
+			std::unique_lock<std::mutex> guard(SleepLock);
+			Wake.wait(guard, []() { return Queued > 0 || Stopping; });
+			if (Stopping && Queued == 0)
+				return;
+		}
+	}
+
+	void Start()
+	{
+		if (Started)
+			return;
+		std::lock_guard<std::mutex> guard(PoolLock);
+		if (Started)
+			return;
+		// The submitting thread helps while it waits, so one worker less than there are cores
+		unsigned cores = std::thread::hardware_concurrency();
+		unsigned workers = cores > 1 ? cores - 1 : 0;
+		Queues.clear();
+		for (unsigned i = 0; i <= workers; i++)
+			Queues.push_back(std::unique_ptr<Queue>(new Queue()));
+		Stopping = false;
+		for (unsigned i = 1; i <= workers; i++)
+			Workers.emplace_back(WorkerLoop, (size_t)i);
+		Started = true;
+	}
+
+	// Queues the task once every handle in after is done
+	void Submit(const TaskPtr& task, const std::vector<JobSystem::Handle>& after)
+	{
+		// One extra count so the task cannot be queued before all handles are registered
+		task->dependencies = (int)after.size() + 1;
+		for (auto& handle : after)
+		{
+			bool done = true;
+			if (handle)
+			{
+				std::lock_guard<std::mutex> guard(handle->lock);
+				if (!handle->done)
+				{
+					handle->waiting.push_back(task);
+					done = false;
+				}
+			}
+			if (done)
+				--task->dependencies;
+		}
+		Release(task);
+	}
+
+	TaskPtr MakeTask(std::function<void()> run, const JobSystem::Handle& counter)
+	{
+		TaskPtr task = std::make_shared<JobSystem::Counter::Task>();
+		task->run = std::move(run);
+		task->counter = counter;
+		return task;
+	}
+}
+
+JobSystem::Handle JobSystem::Schedule(std::function<void()> job, const std::vector<Handle>& after)
+{
+	Start();
+	Handle counter = std::make_shared<Counter>(1);
+	Submit(MakeTask(std::move(job), counter), after);
+	return counter;
+}
+
+JobSystem::Handle JobSystem::ScheduleFor(size_t count, size_t grain, std::function<void(size_t, size_t)> fn,
+	const std::vector<Handle>& after)
+{
+	Start();
+	grain = std::max<size_t>(grain, 1);
+	size_t chunks = (count + grain - 1) / grain;
+	Handle counter = std::make_shared<Counter>((int)std::max<size_t>(chunks, 1));
+	if (chunks == 0)
+	{
+		Submit(MakeTask([]() {}, counter), after);
+		return counter;
+	}
+	// The chunks share the loop body, they are only queued once the dependencies are done
+	auto body = std::make_shared<std::function<void(size_t, size_t)>>(std::move(fn));
+	auto launch = [counter, body, count, grain, chunks]() {
+		for (size_t c = 0; c < chunks; c++)
+		{
+			size_t begin = c * grain, end = std::min(begin + grain, count);
+			TaskPtr task = MakeTask([body, begin, end]() { (*body)(begin, end); }, counter);
+			task->dependencies = 1;
+			Release(task);
+		}
+	};
+	if (after.empty())
+		launch();
+	else
+		Submit(MakeTask(launch, std::make_shared<Counter>(1)), after);
+	return counter;
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+	if (count == 0)
+		return;
+	if (count <= grain)
+	{
+		fn(0, count);
+		return;
+	}
+	// The caller outlives the loop, so the chunks can refer to fn directly
+	const std::function<void(size_t, size_t)>* body = &fn;
+	Wait(ScheduleFor(count, grain, [body](size_t begin, size_t end) { (*body)(begin, end); }));
+}
+
+void JobSystem::Wait(const Handle& handle)
+{
+	if (!handle)
+		return;
+	TaskPtr task;
+	while (handle->pending > 0)
+	{
+		if (Take(task))
+		{
+			Execute(task);
+			task.reset();
+			continue;
+		}
+		// Nothing to help with, the rest of the work is running on other threads
+		std::unique_lock<std::mutex> guard(SleepLock);
+		Wake.wait(guard, [&handle]() { return Queued > 0 || handle->pending == 0; });
+	}
+}
+
+bool JobSystem::Done(const Handle& handle)
+{
+	return !handle || handle->pending == 0;
+}
+
+unsigned JobSystem::Concurrency()
+{
+	Start();
+	return (unsigned)Queues.size();
+}
+
+void JobSystem::Shutdown()
+{
+	std::lock_guard<std::mutex> guard(PoolLock);
+	if (!Started)
+		return;
+	{
+		std::lock_guard<std::mutex> sleep(SleepLock);
+		Stopping = true;
+	}
+	Wake.notify_all();
+	for (auto& worker : Workers)
+		worker.join();
+	Workers.clear();
+	Started = false;
+}
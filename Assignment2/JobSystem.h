@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Fixed pool of worker threads, one per core besides the threads that submit work, with a
+// job deque per worker. A worker pops its own newest job first (its data is still in cache)
+// and steals the oldest job of another deque when its own is empty, so fine grained and
+// unevenly sized jobs still keep every core busy. The pool starts on first use.
+class JobSystem
+{
+public:
+	// Completion of a job or a parallel loop, becomes done once all its work has run
+	class Counter;
+	typedef std::shared_ptr<Counter> Handle;
+
+	// Queues job to run on the pool once every handle in after is done
+	static Handle Schedule(std::function<void()> job, const std::vector<Handle>& after = std::vector<Handle>());
+	// Queues fn(begin, end) over [0, count) in chunks of grain items once every handle in after is done
+	static Handle ScheduleFor(size_t count, size_t grain, std::function<void(size_t, size_t)> fn,
+		const std::vector<Handle>& after = std::vector<Handle>());
+	// Runs fn(begin, end) over [0, count) in chunks of grain items and returns once all are done.
+	// Loops of a single chunk run inline without touching the pool.
+	static void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+	// Blocks until the handle is done, running queued jobs meanwhile so nested waits cannot deadlock.
+	// Sleeps while nothing is queued instead of spinning.
+	static void Wait(const Handle& handle);
+	static bool Done(const Handle& handle);
+
+	// Threads running jobs, the waiting thread included
+	static unsigned Concurrency();
+	// Joins the workers once the queues are empty, the pool restarts on next use
+	static void Shutdown();
+private:
+	JobSystem() {}
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The view stays valid until Close()
+// or destruction, so loaders can read straight from the page cache.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps the file, returns false if it is missing, empty or cannot be mapped
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return data != NULL; }
+	const unsigned char* Data() const { return data; }
+	size_t Size() const { return size; }
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	void* file;    // HANDLE
+	void* mapping; // HANDLE
+#endif
+};
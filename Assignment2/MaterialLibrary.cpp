@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <iostream>
+
+#include <SOIL.h>
+
+#include "MaterialLibrary.h"
+
+std::map<int, MaterialLibrary::ResolutionClass> MaterialLibrary::ClassesByWidth;
+std::map<std::string, Material> MaterialLibrary::Materials;
+bool MaterialLibrary::Dirty = false;
+
+Material MaterialLibrary::Load(const std::string& path)
+{
+	auto it = Materials.find(path);
+	if (it != Materials.end())
+		return it->second;
+
+	int width, height;
+	unsigned char* image = SOIL_load_image(path.c_str(), &width, &height, 0, SOIL_LOAD_RGB);
+	if (image == NULL)
+	{
+		std::cout << "ERROR::MATERIAL::FAILED_TO_LOAD " << path << std::endl;
+		width = height = 1;
+	}
+
+	int classWidth = ClassWidth(width);
+	ResolutionClass& resolution = ClassesByWidth[classWidth];
+	if (resolution.texture == 0)
+	{
+		glGenTextures(1, &resolution.texture);
+		resolution.width = classWidth;
+		resolution.height = classWidth / 2;
+	}
+
+	Material material = { resolution.texture, (GLfloat)(resolution.uploadedLayers + resolution.pending.size()) };
+	if (image != NULL)
+		resolution.pending.push_back(Resample(image, width, height, resolution.width, resolution.height));
+	else
+		resolution.pending.push_back(std::vector<unsigned char>(resolution.width * resolution.height * 3, 255));
+	SOIL_free_image_data(image);
+
+	Materials.insert(std::make_pair(path, material));
+	Dirty = true;
+	return material;
+}
+
+void MaterialLibrary::Upload()
+{
+	if (!Dirty)
+		return;
+	Dirty = false;
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	for (auto& it : ClassesByWidth)
+	{
+		ResolutionClass& resolution = it.second;
+		if (resolution.pending.empty())
+			continue;
+
+		size_t layerBytes = (size_t)resolution.width * resolution.height * 3;
+		GLsizei layers = resolution.uploadedLayers + (GLsizei)resolution.pending.size();
+		glBindTexture(GL_TEXTURE_2D_ARRAY, resolution.texture);
+
+		// Growing an array means reallocating it, so read back what is already there
+		std::vector<unsigned char> previous;
+		if (resolution.uploadedLayers > 0)
+		{
+			previous.resize(layerBytes * resolution.uploadedLayers);
+			glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, GL_UNSIGNED_BYTE, &previous.front());
+		}
+
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, resolution.width, resolution.height, layers,
+			0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+		if (!previous.empty())
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, resolution.width, resolution.height, resolution.uploadedLayers,
+				GL_RGB, GL_UNSIGNED_BYTE, &previous.front());
+		for (size_t i = 0; i < resolution.pending.size(); i++)
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, resolution.uploadedLayers + (GLint)i,
+				resolution.width, resolution.height, 1, GL_RGB, GL_UNSIGNED_BYTE, &resolution.pending[i].front());
+
+		// Longitude wraps around, latitude stops at the poles
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+		resolution.uploadedLayers = layers;
+		std::vector<std::vector<unsigned char>>().swap(resolution.pending);
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+size_t MaterialLibrary::Classes()
+{
+	return ClassesByWidth.size();
+}
+
+void MaterialLibrary::Clear()
+{
+	for (auto& it : ClassesByWidth)
+		glDeleteTextures(1, &it.second.texture);
+	ClassesByWidth.clear();
+	Materials.clear();
+	Dirty = false;
+}
+
+int MaterialLibrary::ClassWidth(int imageWidth)
+{
+	int width = MinWidth;
+	while (width < imageWidth && width < MaxWidth)
+		width *= 2;
+	return width;
+}
+
+std::vector<unsigned char> MaterialLibrary::Resample(const unsigned char* pixels, int width, int height, int newWidth, int newHeight)
+{
+	std::vector<unsigned char> source(pixels, pixels + (size_t)width * height * 3);
+
+	// Halve with a 2x2 box first so large reductions do not alias
+	while (width >= newWidth * 2 && height >= newHeight * 2)
+	{
+		int halfWidth = width / 2, halfHeight = height / 2;
+		std::vector<unsigned char> half((size_t)halfWidth * halfHeight * 3);
+		for (int y = 0; y < halfHeight; y++)
+			for (int x = 0; x < halfWidth; x++)
+				for (int c = 0; c < 3; c++)
+				{
+					const unsigned char* row0 = &source[((size_t)(2 * y) * width + 2 * x) * 3 + c];
+					const unsigned char* row1 = row0 + (size_t)width * 3;
+					half[((size_t)y * halfWidth + x) * 3 + c] = (unsigned char)((row0[0] + row0[3] + row1[0] + row1[3] + 2) / 4);
+				}
+		source.swap(half);
+		width = halfWidth;
+		height = halfHeight;
+	}
+	if (width == newWidth && height == newHeight)
+		return source;
+
+	// Bilinear for the remaining factor
+	std::vector<unsigned char> result((size_t)newWidth * newHeight * 3);
+	for (int y = 0; y < newHeight; y++)
+	{
+		float sy = std::max(0.0f, (y + 0.5f) * height / newHeight - 0.5f);
+		int y0 = std::min((int)sy, height - 1), y1 = std::min(y0 + 1, height - 1);
+		float fy = sy - y0;
+		for (int x = 0; x < newWidth; x++)
+		{
+			float sx = std::max(0.0f, (x + 0.5f) * width / newWidth - 0.5f);
+			int x0 = std::min((int)sx, width - 1), x1 = std::min(x0 + 1, width - 1);
+			float fx = sx - x0;
+			for (int c = 0; c < 3; c++)
+			{
+				float top = source[((size_t)y0 * width + x0) * 3 + c] * (1 - fx) + source[((size_t)y0 * width + x1) * 3 + c] * fx;
+				float bottom = source[((size_t)y1 * width + x0) * 3 + c] * (1 - fx) + source[((size_t)y1 * width + x1) * 3 + c] * fx;
+				result[((size_t)y * newWidth + x) * 3 + c] = (unsigned char)(top * (1 - fy) + bottom * fy + 0.5f);
+			}
+		}
+	}
+	return result;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// A planet surface: one layer of a GL_TEXTURE_2D_ARRAY
+struct Material
+{
+	GLuint texture; // array texture of the material's resolution class
+	GLfloat layer;
+};
+
+// Loads planet textures into texture arrays grouped by resolution class.
+// Images are resampled to their class size (power-of-two width, 2:1 like the
+// equirectangular planet maps), so all bodies of a class share one texture.
+class MaterialLibrary
+{
+public:
+	// Returns the material for an image, loading it on first use.
+	// The layer data reaches the GPU on the next Upload().
+	static Material Load(const std::string& path);
+	// Uploads layers loaded since the last call, does nothing otherwise
+	static void Upload();
+	// Number of texture arrays (resolution classes) in use
+	static size_t Classes();
+	// Deletes every texture array (needs a current GL context)
+	static void Clear();
+
+	// Largest class width, bigger images are scaled down to it
+	static const int MaxWidth = 2048;
+	static const int MinWidth = 256;
+private:
+	MaterialLibrary() {}
+
+	struct ResolutionClass
+	{
+		GLuint texture = 0;
+		int width = 0;
+		int height = 0;
+		GLsizei uploadedLayers = 0;
+		std::vector<std::vector<unsigned char>> pending; // RGB pixels of layers not uploaded yet
+	};
+
+	static int ClassWidth(int imageWidth);
+	// Resamples an RGB image to width x height
+	static std::vector<unsigned char> Resample(const unsigned char* pixels, int width, int height, int newWidth, int newHeight);
+
+	static std::map<int, ResolutionClass> ClassesByWidth;
+	static std::map<std::string, Material> Materials;
+	static bool Dirty;
+};
@@ -0,0 +1,226 @@
+#include <cmath>
+#include <iostream>
+
+#include "MeshCache.h"
+#include "VertexCache.h"
+
+namespace
+{
+	const float PI = acos(-1);
+}
+
+std::map<MeshCache::Key, std::shared_ptr<Mesh>> MeshCache::Spheres;
+
+std::shared_ptr<const Mesh> MeshCache::GetSphere(int sectorCount, int stackCount, bool keepCpuCopy)
+{
+	Key key(sectorCount, stackCount);
+	auto it = Spheres.find(key);
+	if (it != Spheres.end())
+	{
+		std::shared_ptr<Mesh>& mesh = it->second;
+		// A GPU-resident mesh gets its compact copy rebuilt the first time someone needs it
+		if (keepCpuCopy && mesh->positions.empty())
+		{
+			std::vector<GLfloat> texCoords;
+			BuildSphere(sectorCount, stackCount, mesh->positions, texCoords, mesh->indices);
+			mesh->positions.shrink_to_fit();
+			mesh->indices.shrink_to_fit();
+		}
+		return mesh;
+	}
+
+	std::shared_ptr<Mesh> mesh = GenerateSphere(sectorCount, stackCount, keepCpuCopy);
+	Spheres.insert(std::make_pair(key, mesh));
+	return mesh;
+}
+
+size_t MeshCache::Size()
+{
+	return Spheres.size();
+}
+
+void MeshCache::ReportMemory(std::ostream& out)
+{
+	size_t cpuTotal = 0, gpuTotal = 0;
+	for (auto& it : Spheres)
+	{
+		const Mesh& mesh = *it.second;
+		out << "MESH::SPHERE " << it.first.first << "x" << it.first.second << ": "
+			<< mesh.CpuBytes() << " CPU bytes, " << mesh.gpuBytes << " GPU bytes"
+			<< (mesh.positions.empty() ? " (GPU resident)" : " (compact CPU copy)") << std::endl;
+		cpuTotal += mesh.CpuBytes();
+		gpuTotal += mesh.gpuBytes;
+	}
+	out << "MESH::TOTAL " << Spheres.size() << " meshes: "
+		<< cpuTotal << " CPU bytes, " << gpuTotal << " GPU bytes" << std::endl;
+}
+
+void MeshCache::Clear()
+{
+	for (auto& it : Spheres)
+	{
+		glDeleteVertexArrays(1, &it.second->VA);
+		glDeleteBuffers(1, &it.second->VB);
+		glDeleteBuffers(1, &it.second->EB);
+	}
+	Spheres.clear();
+}
+
+float MeshCache::BuildSphere(int sectorCount, int stackCount,
+	std::vector<GLfloat>& vertices, std::vector<GLfloat>& texCoords, std::vector<unsigned>& indices)
+{
+	vertices.clear();
+	texCoords.clear();
+	indices.clear();
+
+	float x, y, z, xy;                              // vertex position
+	float s, t;                                     // vertex texCoord
+
+	float sectorStep = 2 * PI / sectorCount;
+	float stackStep = PI / stackCount;
+	float sectorAngle, stackAngle;
+
+	for (int i = 0; i <= stackCount; ++i)
+	{
+		stackAngle = PI / 2 - i * stackStep;        // starting from pi/2 to -pi/2
+		xy = cosf(stackAngle);                      // cos(u)
+		z = sinf(stackAngle);                       // sin(u)
+
+		// add (sectorCount+1) vertices per stack
+		// the first and last vertices have same position and normal, but different tex coords
+		for (int j = 0; j <= sectorCount; ++j)
+		{
+			sectorAngle = j * sectorStep;           // starting from 0 to 2pi
+
+			// vertex position (x, y, z)
+			x = xy * cosf(sectorAngle);             // cos(u) * cos(v)
+			y = xy * sinf(sectorAngle);             // cos(u) * sin(v)
+			vertices.push_back(x);
+			vertices.push_back(y);
+			vertices.push_back(z);
+			// on a unit sphere the normal is the position, so none are stored
+
+			// vertex tex coord (s, t) range between [0, 1]
+			s = (float)j / sectorCount;
+			t = (float)i / stackCount;
+			texCoords.push_back(s);
+			texCoords.push_back(t);
+		}
+	}
+
+	int k1, k2;
+	for (int i = 0; i < stackCount; ++i)
+	{
+		k1 = i * (sectorCount + 1);
+		k2 = k1 + sectorCount + 1;
+
+		for (int j = 0; j < sectorCount; ++j, ++k1, ++k2)
+		{
+			if (i != 0)
+			{
+				indices.push_back(k1);
+				indices.push_back(k2);
+				indices.push_back(k1 + 1);
+			}
+
+			if (i != (stackCount - 1))
+			{
+				indices.push_back(k1 + 1);
+				indices.push_back(k2);
+				indices.push_back(k2 + 1);
+			}
+		}
+	}
+
+	// Reorder triangles for the post-transform vertex cache
+	unsigned vertexCount = (unsigned)(vertices.size() / 3);
+	float listMissRatio = AverageCacheMissRatio(indices, vertexCount);
+	indices = Tipsify(indices, vertexCount);
+	return listMissRatio;
+}
+
+std::shared_ptr<Mesh> MeshCache::GenerateSphere(int sectorCount, int stackCount, bool keepCpuCopy)
+{
+	std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+	// Only live until the upload is done, unless a compact copy is kept
+	std::vector<GLfloat> vertices;
+	std::vector<GLfloat> texCoords;
+	std::vector<unsigned> indices;
+	float listMissRatio = BuildSphere(sectorCount, stackCount, vertices, texCoords, indices);
+
+	unsigned vertexCount = (unsigned)(vertices.size() / 3);
+	float tipsifyMissRatio = AverageCacheMissRatio(indices, vertexCount);
+
+	// One interleaved vertex per sphere point instead of one per index
+	std::vector<GLfloat> data;
+	data.reserve(vertexCount * 5);
+	for (unsigned i = 0; i < vertexCount; i++) {
+		data.emplace_back(vertices[i * 3]);
+		data.emplace_back(vertices[i * 3 + 1]);
+		data.emplace_back(vertices[i * 3 + 2]);
+		data.emplace_back(texCoords[i * 2]);
+		data.emplace_back(texCoords[i * 2 + 1]);
+	}
+	mesh->nVert = vertexCount;
+	mesh->nIndices = (GLsizei)indices.size();
+
+	// Generate buffers
+	glGenVertexArrays(1, &mesh->VA);
+	glGenBuffers(1, &mesh->VB);
+	glGenBuffers(1, &mesh->EB);
+
+	glBindVertexArray(mesh->VA);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->VB);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * data.size(), &data.front(), GL_STATIC_DRAW);
+
+	// 16-bit indices halve the element buffer whenever the vertex count allows it
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EB);
+	size_t indexSize;
+	if (vertexCount <= 0x10000)
+	{
+		std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+		mesh->indexType = GL_UNSIGNED_SHORT;
+		indexSize = sizeof(GLushort);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize * shortIndices.size(), &shortIndices.front(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		mesh->indexType = GL_UNSIGNED_INT;
+		indexSize = sizeof(GLuint);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize * indices.size(), &indices.front(), GL_STATIC_DRAW);
+	}
+
+	mesh->gpuBytes = sizeof(GLfloat) * data.size() + indexSize * indices.size();
+
+	// set vertex attribute pointers
+	// position attribute
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(1);
+
+	// unbind VA first so it keeps its element buffer binding
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	// Report what indexing saves compared to the expanded triangle list drawn before
+	size_t triangleCount = indices.size() / 3;
+	size_t expandedBytes = indices.size() * 5 * sizeof(GLfloat);
+	std::cout << "MESH::SPHERE " << sectorCount << "x" << stackCount << ": "
+		<< vertexCount << " vertices, " << indices.size() << " indices ("
+		<< (indexSize == sizeof(GLushort) ? "16" : "32") << "-bit)" << std::endl
+		<< "  vertex data " << expandedBytes << " -> " << mesh->gpuBytes << " bytes" << std::endl
+		<< "  vertex shader invocations per draw " << indices.size()
+		<< " -> " << (size_t)(listMissRatio * triangleCount + 0.5f) << " (generated order)"
+		<< " -> " << (size_t)(tipsifyMissRatio * triangleCount + 0.5f) << " (tipsify)" << std::endl;
+
+	if (keepCpuCopy)
+	{
+		vertices.shrink_to_fit();
+		indices.shrink_to_fit();
+		mesh->positions.swap(vertices);
+		mesh->indices.swap(indices);
+	}
+	return mesh;
+}
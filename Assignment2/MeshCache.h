@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Indexed GPU geometry. The arrays it was built from are released once uploaded,
+// unless a compact copy (positions and indices only) was asked for CPU-side queries.
+struct Mesh
+{
+	GLuint VA;
+	GLuint VB;
+	GLuint EB;
+	GLsizei nVert;
+	GLsizei nIndices;
+	GLenum indexType; // GL_UNSIGNED_SHORT when every index fits in 16 bits
+	size_t gpuBytes;  // size of the vertex and element buffers
+
+	// Compact CPU copy, empty for GPU-resident meshes
+	std::vector<GLfloat> positions; // 3 per vertex
+	std::vector<unsigned> indices;  // same order as the element buffer
+
+	// Bytes held on the CPU side for this mesh
+	size_t CpuBytes() const
+	{
+		return sizeof(Mesh) + positions.capacity() * sizeof(GLfloat) + indices.capacity() * sizeof(unsigned);
+	}
+};
+
+// Shares one unit-sphere mesh per (sectorCount, stackCount) tessellation.
+// Spheres apply their radius through the model matrix, so all bodies with the
+// same tessellation draw from the same VAO.
+class MeshCache
+{
+public:
+	// Returns the unit sphere for the given tessellation, generating it on first use.
+	// keepCpuCopy keeps positions and indices around after the upload.
+	static std::shared_ptr<const Mesh> GetSphere(int sectorCount, int stackCount, bool keepCpuCopy = false);
+	// Number of meshes currently owned by the cache
+	static size_t Size();
+	// Prints the CPU and GPU footprint of every cached mesh
+	static void ReportMemory(std::ostream& out);
+	// Deletes every mesh owned by the cache (needs a current GL context)
+	static void Clear();
+private:
+	MeshCache() {}
+	// Builds the unit sphere vertices (position + texCoord) and vertex-cache optimised indices.
+	// Returns the cache miss ratio of the indices before they were reordered.
+	static float BuildSphere(int sectorCount, int stackCount,
+		std::vector<GLfloat>& vertices, std::vector<GLfloat>& texCoords, std::vector<unsigned>& indices);
+	static std::shared_ptr<Mesh> GenerateSphere(int sectorCount, int stackCount, bool keepCpuCopy);
+
+	typedef std::pair<int, int> Key;
+	static std::map<Key, std::shared_ptr<Mesh>> Spheres;
+};
@@ -0,0 +1,535 @@
+#include "NBodySystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "JobSystem.h"
+#include "Simd.h"
+
+namespace
+{
+	// Spreads the 10 low bits of v three bits apart
+	uint32_t SpreadBits(uint32_t v)
+	{
+		v &= 0x3ff;
+		v = (v | (v << 16)) & 0x030000ff;
+		v = (v | (v << 8)) & 0x0300f00f;
+		v = (v | (v << 4)) & 0x030c30c3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+
+	// Adds the softened attraction of every source to every target. Targets are the
+	// SIMD lanes, so the sums stay in registers and no horizontal reduction is needed.
+	// The SIMD paths use the reciprocal square root estimate refined by one Newton step
+	// (about 23 bits) instead of a square root and a division.
+	void Attract(const float* sx, const float* sy, const float* sz, const float* sm, size_t sources,
+		const float* tx, const float* ty, const float* tz, float* fx, float* fy, float* fz, size_t targets, float eps2)
+	{
+		size_t i = 0;
+#if defined(SIMD_AVX2)
+		__m256 soft = _mm256_set1_ps(eps2);
+		__m256 half = _mm256_set1_ps(0.5f), threeHalves = _mm256_set1_ps(1.5f);
+		for (; i + 8 <= targets; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(tx + i), y = _mm256_loadu_ps(ty + i), z = _mm256_loadu_ps(tz + i);
+			__m256 ax = _mm256_loadu_ps(fx + i), ay = _mm256_loadu_ps(fy + i), az = _mm256_loadu_ps(fz + i);
+			for (size_t j = 0; j < sources; j++)
+			{
+				__m256 ex = _mm256_sub_ps(_mm256_set1_ps(sx[j]), x);
+				__m256 ey = _mm256_sub_ps(_mm256_set1_ps(sy[j]), y);
+				__m256 ez = _mm256_sub_ps(_mm256_set1_ps(sz[j]), z);
+				__m256 e2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)),
+					_mm256_add_ps(_mm256_mul_ps(ez, ez), soft));
+				__m256 r = _mm256_rsqrt_ps(e2);
+				r = _mm256_mul_ps(r, _mm256_sub_ps(threeHalves, _mm256_mul_ps(_mm256_mul_ps(half, e2), _mm256_mul_ps(r, r))));
+				__m256 f = _mm256_mul_ps(_mm256_set1_ps(sm[j]), _mm256_mul_ps(r, _mm256_mul_ps(r, r)));
+				ax = _mm256_add_ps(ax, _mm256_mul_ps(ex, f));
+				ay = _mm256_add_ps(ay, _mm256_mul_ps(ey, f));
+				az = _mm256_add_ps(az, _mm256_mul_ps(ez, f));
+			}
+			_mm256_storeu_ps(fx + i, ax);
+			_mm256_storeu_ps(fy + i, ay);
+			_mm256_storeu_ps(fz + i, az);
+		}
+#elif defined(SIMD_SSE2)
+		__m128 soft = _mm_set1_ps(eps2);
+		__m128 half = _mm_set1_ps(0.5f), threeHalves = _mm_set1_ps(1.5f);
+		for (; i + 4 <= targets; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(tx + i), y = _mm_loadu_ps(ty + i), z = _mm_loadu_ps(tz + i);
+			__m128 ax = _mm_loadu_ps(fx + i), ay = _mm_loadu_ps(fy + i), az = _mm_loadu_ps(fz + i);
+			for (size_t j = 0; j < sources; j++)
+			{
+				__m128 ex = _mm_sub_ps(_mm_set1_ps(sx[j]), x);
+				__m128 ey = _mm_sub_ps(_mm_set1_ps(sy[j]), y);
+				__m128 ez = _mm_sub_ps(_mm_set1_ps(sz[j]), z);
+				__m128 e2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)),
+					_mm_add_ps(_mm_mul_ps(ez, ez), soft));
+				__m128 r = _mm_rsqrt_ps(e2);
+				r = _mm_mul_ps(r, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, e2), _mm_mul_ps(r, r))));
+				__m128 f = _mm_mul_ps(_mm_set1_ps(sm[j]), _mm_mul_ps(r, _mm_mul_ps(r, r)));
+				ax = _mm_add_ps(ax, _mm_mul_ps(ex, f));
+				ay = _mm_add_ps(ay, _mm_mul_ps(ey, f));
+				az = _mm_add_ps(az, _mm_mul_ps(ez, f));
+			}
+			_mm_storeu_ps(fx + i, ax);
+			_mm_storeu_ps(fy + i, ay);
+			_mm_storeu_ps(fz + i, az);
+		}
+#endif
+		for (; i < targets; i++)
+		{
+			for (size_t j = 0; j < sources; j++)
+			{
+				float ex = sx[j] - tx[i], ey = sy[j] - ty[i], ez = sz[j] - tz[i];
+				float e2 = ex * ex + ey * ey + ez * ez + eps2;
+				float f = sm[j] / (e2 * std::sqrt(e2));
+				fx[i] += ex * f;
+				fy[i] += ey * f;
+				fz[i] += ez * f;
+			}
+		}
+	}
+
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+NBodySystem::NBodySystem() : theta(0.7f), softening(0.01f), forcesValid(false),
+	buildMilliseconds(0.0), forceMilliseconds(0.0)
+{
+
+}
+
+size_t NBodySystem::Add(const glm::vec3& position, const glm::vec3& velocity, float bodyMass)
+{
+	size_t bodyId = px.size();
+	px.push_back(position.x);
+	py.push_back(position.y);
+	pz.push_back(position.z);
+	vx.push_back(velocity.x);
+	vy.push_back(velocity.y);
+	vz.push_back(velocity.z);
+	ax.push_back(0.0f);
+	ay.push_back(0.0f);
+	az.push_back(0.0f);
+	mass.push_back(bodyMass);
+	id.push_back((uint32_t)bodyId);
+	slot.push_back((uint32_t)bodyId);
+	code.push_back(0);
+	forcesValid = false;
+	return bodyId;
+}
+
+void NBodySystem::Clear()
+{
+	for (std::vector<float>* field : { &px, &py, &pz, &vx, &vy, &vz, &ax, &ay, &az, &mass })
+		field->clear();
+	id.clear();
+	slot.clear();
+	code.clear();
+	nodes.clear();
+	forcesValid = false;
+}
+
+glm::vec3 NBodySystem::Position(size_t bodyId) const
+{
+	uint32_t s = slot[bodyId];
+	return glm::vec3(px[s], py[s], pz[s]);
+}
+
+glm::vec3 NBodySystem::Velocity(size_t bodyId) const
+{
+	uint32_t s = slot[bodyId];
+	return glm::vec3(vx[s], vy[s], vz[s]);
+}
+
+glm::vec3 NBodySystem::Acceleration(size_t bodyId) const
+{
+	uint32_t s = slot[bodyId];
+	return glm::vec3(ax[s], ay[s], az[s]);
+}
+
+void NBodySystem::Step(float dt)
+{
+	if (px.empty())
+		return;
+	if (!forcesValid)
+	{
+		BuildTree();
+		ComputeForces();
+	}
+
+	// Kick half a step, drift a full step, then kick again with the new forces
+	Kick(0.5f * dt);
+	JobSystem::ParallelFor(px.size(), 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			px[i] += vx[i] * dt;
+			py[i] += vy[i] * dt;
+			pz[i] += vz[i] * dt;
+		}
+	});
+	BuildTree();
+	ComputeForces();
+	Kick(0.5f * dt);
+}
+
+void NBodySystem::Kick(float dt)
+{
+	JobSystem::ParallelFor(px.size(), 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			vx[i] += ax[i] * dt;
+			vy[i] += ay[i] * dt;
+			vz[i] += az[i] * dt;
+		}
+	});
+}
+
+void NBodySystem::BuildTree()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// Bounding cube of all bodies, slightly enlarged so the far faces quantise inside the grid
+	glm::vec3 lo(px[0], py[0], pz[0]), hi = lo;
+	for (size_t i = 1; i < px.size(); i++)
+	{
+		lo = glm::vec3(std::min(lo.x, px[i]), std::min(lo.y, py[i]), std::min(lo.z, pz[i]));
+		hi = glm::vec3(std::max(hi.x, px[i]), std::max(hi.y, py[i]), std::max(hi.z, pz[i]));
+	}
+	float size = std::max(std::max(hi.x - lo.x, hi.y - lo.y), hi.z - lo.z) * 1.001f + 1e-6f;
+	SortBodies(lo, size);
+
+	// The top levels are split serially, every cell at SplitLevel becomes a subtree for the workers
+	TopCell root = { 0, (uint32_t)px.size(), 0, lo, size, -1, std::vector<TopCell>() };
+	tasks.clear();
+	PlanTop(root);
+	subtrees.resize(tasks.size());
+	JobSystem::ParallelFor(tasks.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++)
+		{
+			const TopCell& cell = *tasks[t];
+			subtrees[t].clear();
+			BuildSubtree(cell.begin, cell.end, cell.level, cell.corner, cell.size, subtrees[t]);
+		}
+	});
+
+	nodes.clear();
+	AppendTop(root);
+	tasks.clear();
+	buildMilliseconds = Milliseconds(start);
+}
+
+void NBodySystem::SortBodies(const glm::vec3& corner, float size)
+{
+	size_t count = px.size();
+	unsigned workers = JobSystem::Concurrency();
+	float scale = (1 << MortonBits) / size;
+	JobSystem::ParallelFor(count, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			uint32_t x = (uint32_t)((px[i] - corner.x) * scale);
+			uint32_t y = (uint32_t)((py[i] - corner.y) * scale);
+			uint32_t z = (uint32_t)((pz[i] - corner.z) * scale);
+			code[i] = (SpreadBits(x) << 2) | (SpreadBits(y) << 1) | SpreadBits(z);
+		}
+	});
+
+	// Stable LSD radix sort of the slots by code, 10 bits per pass. Each worker counts its
+	// own block, the prefix sums give every (block, bucket) pair its place in the output.
+	const int RadixBits = 10;
+	const uint32_t Buckets = 1 << RadixBits;
+	std::vector<uint32_t> keys(code), order(count), nextKeys(count), nextOrder(count);
+	for (size_t i = 0; i < count; i++)
+		order[i] = (uint32_t)i;
+	size_t blocks = std::min<size_t>(workers, (count + 4095) / 4096);
+	size_t blockSize = (count + blocks - 1) / blocks;
+	std::vector<uint32_t> offsets(blocks * Buckets);
+	for (int pass = 0; pass < 3 * MortonBits / RadixBits; pass++)
+	{
+		int shift = pass * RadixBits;
+		std::fill(offsets.begin(), offsets.end(), 0);
+		JobSystem::ParallelFor(blocks, 1, [&](size_t b, size_t) {
+			uint32_t* histogram = &offsets[b * Buckets];
+			for (size_t i = b * blockSize; i < std::min(count, (b + 1) * blockSize); i++)
+				histogram[(keys[i] >> shift) & (Buckets - 1)]++;
+		});
+		uint32_t total = 0;
+		for (uint32_t bucket = 0; bucket < Buckets; bucket++)
+			for (size_t b = 0; b < blocks; b++)
+			{
+				uint32_t n = offsets[b * Buckets + bucket];
+				offsets[b * Buckets + bucket] = total;
+				total += n;
+			}
+		JobSystem::ParallelFor(blocks, 1, [&](size_t b, size_t) {
+			uint32_t* position = &offsets[b * Buckets];
+			for (size_t i = b * blockSize; i < std::min(count, (b + 1) * blockSize); i++)
+			{
+				uint32_t target = position[(keys[i] >> shift) & (Buckets - 1)]++;
+				nextKeys[target] = keys[i];
+				nextOrder[target] = order[i];
+			}
+		});
+		keys.swap(nextKeys);
+		order.swap(nextOrder);
+	}
+
+	// Move every body array into Morton order so cells are contiguous in memory
+	code.swap(keys);
+	std::vector<float>* fields[] = { &px, &py, &pz, &vx, &vy, &vz, &ax, &ay, &az, &mass };
+	JobSystem::ParallelFor(sizeof(fields) / sizeof(fields[0]) + 1, 1, [&](size_t f, size_t) {
+		if (f < sizeof(fields) / sizeof(fields[0]))
+		{
+			std::vector<float>& field = *fields[f];
+			std::vector<float> sorted(count);
+			for (size_t i = 0; i < count; i++)
+				sorted[i] = field[order[i]];
+			field.swap(sorted);
+		}
+		else
+		{
+			std::vector<uint32_t> sorted(count);
+			for (size_t i = 0; i < count; i++)
+				sorted[i] = id[order[i]];
+			id.swap(sorted);
+			for (size_t i = 0; i < count; i++)
+				slot[id[i]] = (uint32_t)i;
+		}
+	});
+}
+
+void NBodySystem::PlanTop(TopCell& cell)
+{
+	if (cell.level == SplitLevel || cell.end - cell.begin <= LeafSize)
+	{
+		cell.task = (int)tasks.size();
+		tasks.push_back(&cell);
+		return;
+	}
+
+	// Bodies are sorted, each octant is the range whose next three code bits match it
+	int shift = 3 * (MortonBits - 1 - cell.level);
+	float half = cell.size * 0.5f;
+	uint32_t childBegin = cell.begin;
+	cell.children.reserve(8);
+	for (uint32_t octant = 0; octant < 8; octant++)
+	{
+		uint32_t childEnd = (uint32_t)(std::partition_point(code.begin() + childBegin, code.begin() + cell.end,
+			[&](uint32_t c) { return ((c >> shift) & 7) <= octant; }) - code.begin());
+		if (childEnd > childBegin)
+		{
+			glm::vec3 corner = cell.corner + half * glm::vec3((float)(octant >> 2), (float)((octant >> 1) & 1), (float)(octant & 1));
+			TopCell child = { childBegin, childEnd, cell.level + 1, corner, half, -1, std::vector<TopCell>() };
+			cell.children.push_back(child);
+		}
+		childBegin = childEnd;
+	}
+	for (TopCell& child : cell.children)
+		PlanTop(child);
+}
+
+void NBodySystem::BuildSubtree(uint32_t begin, uint32_t end, int level, glm::vec3 corner, float size,
+	std::vector<Node>& out) const
+{
+	uint32_t index = (uint32_t)out.size();
+	out.push_back(Node());
+	float m = 0.0f, mx = 0.0f, my = 0.0f, mz = 0.0f;
+
+	if (end - begin <= LeafSize || level == MortonBits)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			m += mass[i];
+			mx += mass[i] * px[i];
+			my += mass[i] * py[i];
+			mz += mass[i] * pz[i];
+		}
+	}
+	else
+	{
+		int shift = 3 * (MortonBits - 1 - level);
+		float half = size * 0.5f;
+		uint32_t childBegin = begin;
+		for (uint32_t octant = 0; octant < 8 && childBegin < end; octant++)
+		{
+			uint32_t childEnd = (uint32_t)(std::partition_point(code.begin() + childBegin, code.begin() + end,
+				[&](uint32_t c) { return ((c >> shift) & 7) <= octant; }) - code.begin());
+			if (childEnd > childBegin)
+			{
+				uint32_t child = (uint32_t)out.size();
+				glm::vec3 childCorner = corner + half * glm::vec3((float)(octant >> 2), (float)((octant >> 1) & 1), (float)(octant & 1));
+				BuildSubtree(childBegin, childEnd, level + 1, childCorner, half, out);
+				m += out[child].mass;
+				mx += out[child].mass * out[child].x;
+				my += out[child].mass * out[child].y;
+				mz += out[child].mass * out[child].z;
+			}
+			childBegin = childEnd;
+		}
+	}
+
+	Node& node = out[index];
+	glm::vec3 centre = m > 0.0f ? glm::vec3(mx / m, my / m, mz / m) : corner + glm::vec3(size * 0.5f);
+	node.x = centre.x;
+	node.y = centre.y;
+	node.z = centre.z;
+	node.mass = m;
+	node.size = size;
+	node.first = begin;
+	node.count = end - begin;
+	node.next = (uint32_t)out.size();
+}
+
+void NBodySystem::AppendTop(const TopCell& cell)
+{
+	if (cell.task >= 0)
+	{
+		// Subtree indices are local to the worker's array
+		uint32_t base = (uint32_t)nodes.size();
+		for (Node node : subtrees[cell.task])
+		{
+			node.next += base;
+			nodes.push_back(node);
+		}
+		return;
+	}
+
+	uint32_t index = (uint32_t)nodes.size();
+	nodes.push_back(Node());
+	float m = 0.0f, mx = 0.0f, my = 0.0f, mz = 0.0f;
+	for (const TopCell& child : cell.children)
+	{
+		uint32_t childIndex = (uint32_t)nodes.size();
+		AppendTop(child);
+		const Node& childNode = nodes[childIndex];
+		m += childNode.mass;
+		mx += childNode.mass * childNode.x;
+		my += childNode.mass * childNode.y;
+		mz += childNode.mass * childNode.z;
+	}
+	Node& node = nodes[index];
+	glm::vec3 centre = m > 0.0f ? glm::vec3(mx / m, my / m, mz / m) : cell.corner + glm::vec3(cell.size * 0.5f);
+	node.x = centre.x;
+	node.y = centre.y;
+	node.z = centre.z;
+	node.mass = m;
+	node.size = cell.size;
+	node.first = cell.begin;
+	node.count = cell.end - cell.begin;
+	node.next = (uint32_t)nodes.size();
+}
+
+void NBodySystem::ComputeForces()
+{
+	auto start = std::chrono::steady_clock::now();
+	const float theta2 = theta * theta;
+	const float eps2 = softening * softening;
+	const uint32_t nodeCount = (uint32_t)nodes.size();
+
+	// Groups are the largest cells with at most GroupSize bodies
+	groups.clear();
+	for (uint32_t n = 0; n < nodeCount;)
+	{
+		if (nodes[n].count <= GroupSize || nodes[n].next == n + 1)
+		{
+			groups.push_back(n);
+			n = nodes[n].next;
+		}
+		else
+			n++;
+	}
+
+	JobSystem::ParallelFor(groups.size(), 16, [&](size_t begin, size_t end) {
+		std::vector<float> cellX, cellY, cellZ, cellMass;
+		std::vector<uint32_t> leaves;
+		for (size_t g = begin; g < end; g++)
+		{
+			const Node& group = nodes[groups[g]];
+			uint32_t first = group.first, count = group.count;
+			glm::vec3 lo(px[first], py[first], pz[first]), hi = lo;
+			for (uint32_t i = first + 1; i < first + count; i++)
+			{
+				lo = glm::vec3(std::min(lo.x, px[i]), std::min(lo.y, py[i]), std::min(lo.z, pz[i]));
+				hi = glm::vec3(std::max(hi.x, px[i]), std::max(hi.y, py[i]), std::max(hi.z, pz[i]));
+			}
+
+			// One walk for the whole group: a cell is accepted when it is far enough from every
+			// body of the group, that is from the nearest point of the group's bounding box
+			cellX.clear();
+			cellY.clear();
+			cellZ.clear();
+			cellMass.clear();
+			leaves.clear();
+			uint32_t n = 0;
+			while (n < nodeCount)
+			{
+				const Node& node = nodes[n];
+				float dx = std::max(std::max(lo.x - node.x, node.x - hi.x), 0.0f);
+				float dy = std::max(std::max(lo.y - node.y, node.y - hi.y), 0.0f);
+				float dz = std::max(std::max(lo.z - node.z, node.z - hi.z), 0.0f);
+				float d2 = dx * dx + dy * dy + dz * dz;
+				if (node.size * node.size < theta2 * d2)
+				{
+					cellX.push_back(node.x);
+					cellY.push_back(node.y);
+					cellZ.push_back(node.z);
+					cellMass.push_back(node.mass);
+					n = node.next;
+				}
+				else if (node.next == n + 1)
+				{
+					leaves.push_back(n);
+					n = node.next;
+				}
+				else
+					n++;
+			}
+
+			// Leaves at the finest level keep every body of their cell however many there are, so
+			// the targets go through GroupSize at a time, all sharing the walk above. They are padded
+			// to whole SIMD registers with copies of the last body, the extra lanes are computed and dropped.
+			const uint32_t Lanes = 8;
+			for (uint32_t chunk = first; chunk < first + count; chunk += GroupSize)
+			{
+				uint32_t targets = first + count - chunk < GroupSize ? first + count - chunk : GroupSize;
+				uint32_t padded = (targets + Lanes - 1) / Lanes * Lanes;
+				float tx[GroupSize], ty[GroupSize], tz[GroupSize];
+				float fx[GroupSize], fy[GroupSize], fz[GroupSize];
+				for (uint32_t i = 0; i < padded; i++)
+				{
+					uint32_t body = chunk + std::min(i, targets - 1);
+					tx[i] = px[body];
+					ty[i] = py[body];
+					tz[i] = pz[body];
+					fx[i] = fy[i] = fz[i] = 0.0f;
+				}
+
+				// Far cells, then the bodies of near leaves; a body's own term vanishes since its offset is zero
+				if (!cellMass.empty())
+					Attract(&cellX.front(), &cellY.front(), &cellZ.front(), &cellMass.front(), cellMass.size(),
+						tx, ty, tz, fx, fy, fz, padded, eps2);
+				for (uint32_t leaf : leaves)
+				{
+					const Node& node = nodes[leaf];
+					Attract(&px[node.first], &py[node.first], &pz[node.first], &mass[node.first], node.count,
+						tx, ty, tz, fx, fy, fz, padded, eps2);
+				}
+				for (uint32_t i = 0; i < targets; i++)
+				{
+					ax[chunk + i] = fx[i];
+					ay[chunk + i] = fy[i];
+					az[chunk + i] = fz[i];
+				}
+			}
+		}
+	});
+
+	forcesValid = true;
+	forceMilliseconds = Milliseconds(start);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Gravitational N-body simulation. Forces come from a Barnes-Hut octree rebuilt every
+// step: bodies are sorted along a Morton curve, so every octree cell is a contiguous range
+// of the (physically reordered) body arrays, and the subtrees are built on all cores.
+// The tree is walked once per group of nearby bodies rather than once per body, and the
+// resulting interaction list is applied to the whole group.
+// Integration is kick-drift-kick leapfrog, which is symplectic, so orbits do not drift
+// in energy over long runs. Masses are gravitational parameters (G * m).
+class NBodySystem
+{
+public:
+	NBodySystem();
+
+	// Adds a body, returns its id (insertion order, unaffected by the internal sorting)
+	size_t Add(const glm::vec3& position, const glm::vec3& velocity, float mass);
+	void Clear();
+	size_t Size() const { return px.size(); }
+
+	// Advances every body by dt simulated seconds
+	void Step(float dt);
+
+	glm::vec3 Position(size_t id) const;
+	glm::vec3 Velocity(size_t id) const;
+	// Gravitational acceleration from the last force evaluation
+	glm::vec3 Acceleration(size_t id) const;
+
+	// Cost of the last tree build and force evaluation, in milliseconds
+	double BuildMilliseconds() const { return buildMilliseconds; }
+	double ForceMilliseconds() const { return forceMilliseconds; }
+	size_t NodeCount() const { return nodes.size(); }
+
+	// Opening angle: a cell is used as a point mass when its size is below theta times its distance
+	float theta;
+	// Plummer softening length, keeps close encounters finite
+	float softening;
+private:
+	// Cells hold their centre of mass and are stored depth first: the first child
+	// of an internal cell follows it, next skips the whole subtree, so a cell is a
+	// leaf exactly when next is the following node
+	struct Node
+	{
+		float x, y, z, mass;
+		float size;       // side of the cubic cell
+		uint32_t first;   // first body of the cell
+		uint32_t count;   // bodies in the cell
+		uint32_t next;    // node after this subtree
+	};
+	// Cell of the top levels, built serially before the subtrees below it are built in parallel
+	struct TopCell
+	{
+		uint32_t begin, end;
+		int level;
+		glm::vec3 corner;
+		float size;
+		int task;                     // subtree built by a worker, or -1 for an internal top cell
+		std::vector<TopCell> children;
+	};
+
+	static const int MortonBits = 10;  // per axis
+	static const int SplitLevel = 2;   // up to 64 subtrees built in parallel
+	static const uint32_t LeafSize = 8;
+	static const uint32_t GroupSize = 128; // bodies sharing one tree walk, a multiple of 8; leaves at the finest level may hold more
+
+	void BuildTree();
+	void SortBodies(const glm::vec3& corner, float size);
+	void PlanTop(TopCell& cell);
+	void BuildSubtree(uint32_t begin, uint32_t end, int level, glm::vec3 corner, float size, std::vector<Node>& out) const;
+	void AppendTop(const TopCell& cell);
+	void ComputeForces();
+	void Kick(float dt);
+
+	// Body state, in Morton order since the last tree build
+	std::vector<float> px, py, pz;
+	std::vector<float> vx, vy, vz;
+	std::vector<float> ax, ay, az;
+	std::vector<float> mass;
+	std::vector<uint32_t> id;    // id of the body in each slot
+	std::vector<uint32_t> slot;  // slot of each id
+	std::vector<uint32_t> code;  // Morton code of each slot
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> groups;  // cells whose bodies share a tree walk
+	std::vector<std::vector<Node>> subtrees;
+	std::vector<TopCell*> tasks;
+	bool forcesValid;
+	double buildMilliseconds, forceMilliseconds;
+};
@@ -0,0 +1,199 @@
+#include "OrbitKernel.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "Simd.h"
+
+// sincos in single precision: the argument is reduced to [-pi/4, pi/4] around the nearest
+// multiple of pi/2 (subtracted in three parts to keep the low bits), then minimax polynomials
+// give sin and cos of the remainder and the quadrant swaps and negates them. Accurate to a
+// few ulp on the small range the solver feeds it, mean anomalies being reduced to [0, 2pi).
+namespace
+{
+	// Newton steps on E - e sin E = M, enough for float precision up to MaxOrbitEccentricity.
+	// They start from Danby's E = M + 0.85 e sign(sin M), which unlike M + e sin M stays in
+	// the basin of convergence for very eccentric orbits near the periapsis.
+	const int KeplerIterations = 7;
+	const float DanbyFactor = 0.85f;
+	const float TwoOverPi = 0.636619772f;
+	const float PiOver2A = 1.5703125f;
+	const float PiOver2B = 4.83751297e-4f;
+	const float PiOver2C = 7.54978995e-8f;
+	const float S1 = -1.6666654611e-1f, S2 = 8.3321608736e-3f, S3 = -1.9515295891e-4f;
+	const float C1 = 4.166664568298827e-2f, C2 = -1.388731625493765e-3f, C3 = 2.443315711809948e-5f;
+
+	inline void SinCos(float x, float& s, float& c)
+	{
+		float q = x * TwoOverPi;
+		int32_t quadrant = (int32_t)(q < 0.0f ? q - 0.5f : q + 0.5f);
+		float j = (float)quadrant;
+		float r = ((x - j * PiOver2A) - j * PiOver2B) - j * PiOver2C;
+		float r2 = r * r;
+		float sr = r + r * r2 * (S1 + r2 * (S2 + r2 * S3));
+		float cr = 1.0f - 0.5f * r2 + r2 * r2 * (C1 + r2 * (C2 + r2 * C3));
+		if (quadrant & 1)
+		{
+			float t = sr;
+			sr = cr;
+			cr = t;
+		}
+		s = (quadrant & 2) ? -sr : sr;
+		c = ((quadrant + 1) & 2) ? -cr : cr;
+	}
+
+#ifdef SIMD_SSE2
+	inline void SinCos(__m128 x, __m128& s, __m128& c)
+	{
+		__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TwoOverPi)));
+		__m128 j = _mm_cvtepi32_ps(quadrant);
+		__m128 r = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(PiOver2A)));
+		r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(PiOver2B)));
+		r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(PiOver2C)));
+		__m128 r2 = _mm_mul_ps(r, r);
+
+		__m128 sp = _mm_add_ps(_mm_set1_ps(S2), _mm_mul_ps(r2, _mm_set1_ps(S3)));
+		sp = _mm_add_ps(_mm_set1_ps(S1), _mm_mul_ps(r2, sp));
+		__m128 sr = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), sp));
+		__m128 cp = _mm_add_ps(_mm_set1_ps(C2), _mm_mul_ps(r2, _mm_set1_ps(C3)));
+		cp = _mm_add_ps(_mm_set1_ps(C1), _mm_mul_ps(r2, cp));
+		__m128 cr = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)),
+			_mm_mul_ps(_mm_mul_ps(r2, r2), cp));
+
+		// Odd quadrants swap sin and cos, bit 1 of the quadrant (and of quadrant + 1) gives the signs
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+		__m128 sv = _mm_or_ps(_mm_and_ps(swap, cr), _mm_andnot_ps(swap, sr));
+		__m128 cv = _mm_or_ps(_mm_and_ps(swap, sr), _mm_andnot_ps(swap, cr));
+		__m128 sSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+		__m128 cSign = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+		s = _mm_xor_ps(sv, sSign);
+		c = _mm_xor_ps(cv, cSign);
+	}
+
+#endif
+
+#ifdef SIMD_AVX2
+	inline void SinCos(__m256 x, __m256& s, __m256& c)
+	{
+		__m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(TwoOverPi)));
+		__m256 j = _mm256_cvtepi32_ps(quadrant);
+		__m256 r = _mm256_sub_ps(x, _mm256_mul_ps(j, _mm256_set1_ps(PiOver2A)));
+		r = _mm256_sub_ps(r, _mm256_mul_ps(j, _mm256_set1_ps(PiOver2B)));
+		r = _mm256_sub_ps(r, _mm256_mul_ps(j, _mm256_set1_ps(PiOver2C)));
+		__m256 r2 = _mm256_mul_ps(r, r);
+
+		__m256 sp = _mm256_add_ps(_mm256_set1_ps(S2), _mm256_mul_ps(r2, _mm256_set1_ps(S3)));
+		sp = _mm256_add_ps(_mm256_set1_ps(S1), _mm256_mul_ps(r2, sp));
+		__m256 sr = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), sp));
+		__m256 cp = _mm256_add_ps(_mm256_set1_ps(C2), _mm256_mul_ps(r2, _mm256_set1_ps(C3)));
+		cp = _mm256_add_ps(_mm256_set1_ps(C1), _mm256_mul_ps(r2, cp));
+		__m256 cr = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_set1_ps(0.5f), r2)),
+			_mm256_mul_ps(_mm256_mul_ps(r2, r2), cp));
+
+		// Odd quadrants swap sin and cos, bit 1 of the quadrant (and of quadrant + 1) gives the signs
+		__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+			_mm256_and_si256(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+		__m256 sv = _mm256_blendv_ps(sr, cr, swap);
+		__m256 cv = _mm256_blendv_ps(cr, sr, swap);
+		__m256 sSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+		__m256 cSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+			_mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+		s = _mm256_xor_ps(sv, sSign);
+		c = _mm256_xor_ps(cv, cSign);
+	}
+
+#endif
+}
+
+void SolveOrbitsScalar(const float* meanAnomaly, const float* semiMajor, const float* eccentricity,
+	const float* periapsisCos, const float* periapsisSin, float* x, float* z, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		float m = meanAnomaly[i];
+		float e = eccentricity[i];
+		float s, c;
+		SinCos(m, s, c);
+		float ea = m + (s < 0.0f ? -DanbyFactor : DanbyFactor) * e;
+		for (int iteration = 0; iteration < KeplerIterations; iteration++)
+		{
+			SinCos(ea, s, c);
+			ea -= (ea - e * s - m) / (1.0f - e * c);
+		}
+		SinCos(ea, s, c);
+
+		// Position in the orbital plane with the focus at the origin, then turned to the periapsis
+		float px = semiMajor[i] * (c - e);
+		float pz = semiMajor[i] * std::sqrt(1.0f - e * e) * s;
+		x[i] = px * periapsisCos[i] - pz * periapsisSin[i];
+		z[i] = px * periapsisSin[i] + pz * periapsisCos[i];
+	}
+}
+
+void SolveOrbits(const float* meanAnomaly, const float* semiMajor, const float* eccentricity,
+	const float* periapsisCos, const float* periapsisSin, float* x, float* z, size_t count)
+{
+	size_t i = 0;
+#if defined(SIMD_AVX2)
+	__m256 one = _mm256_set1_ps(1.0f);
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 m = _mm256_loadu_ps(meanAnomaly + i);
+		__m256 e = _mm256_loadu_ps(eccentricity + i);
+		__m256 s, c;
+		SinCos(m, s, c);
+		__m256 start = _mm256_mul_ps(_mm256_set1_ps(DanbyFactor), e);
+		__m256 ea = _mm256_add_ps(m, _mm256_or_ps(start, _mm256_and_ps(s, _mm256_set1_ps(-0.0f))));
+		for (int iteration = 0; iteration < KeplerIterations; iteration++)
+		{
+			SinCos(ea, s, c);
+			__m256 f = _mm256_sub_ps(_mm256_sub_ps(ea, _mm256_mul_ps(e, s)), m);
+			ea = _mm256_sub_ps(ea, _mm256_div_ps(f, _mm256_sub_ps(one, _mm256_mul_ps(e, c))));
+		}
+		SinCos(ea, s, c);
+
+		__m256 a = _mm256_loadu_ps(semiMajor + i);
+		__m256 px = _mm256_mul_ps(a, _mm256_sub_ps(c, e));
+		__m256 pz = _mm256_mul_ps(_mm256_mul_ps(a, _mm256_sqrt_ps(_mm256_sub_ps(one, _mm256_mul_ps(e, e)))), s);
+		__m256 wc = _mm256_loadu_ps(periapsisCos + i);
+		__m256 ws = _mm256_loadu_ps(periapsisSin + i);
+		_mm256_storeu_ps(x + i, _mm256_sub_ps(_mm256_mul_ps(px, wc), _mm256_mul_ps(pz, ws)));
+		_mm256_storeu_ps(z + i, _mm256_add_ps(_mm256_mul_ps(px, ws), _mm256_mul_ps(pz, wc)));
+	}
+#elif defined(SIMD_SSE2)
+	__m128 one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 m = _mm_loadu_ps(meanAnomaly + i);
+		__m128 e = _mm_loadu_ps(eccentricity + i);
+		__m128 s, c;
+		SinCos(m, s, c);
+		__m128 start = _mm_mul_ps(_mm_set1_ps(DanbyFactor), e);
+		__m128 ea = _mm_add_ps(m, _mm_or_ps(start, _mm_and_ps(s, _mm_set1_ps(-0.0f))));
+		for (int iteration = 0; iteration < KeplerIterations; iteration++)
+		{
+			SinCos(ea, s, c);
+			__m128 f = _mm_sub_ps(_mm_sub_ps(ea, _mm_mul_ps(e, s)), m);
+			ea = _mm_sub_ps(ea, _mm_div_ps(f, _mm_sub_ps(one, _mm_mul_ps(e, c))));
+		}
+		SinCos(ea, s, c);
+
+		__m128 a = _mm_loadu_ps(semiMajor + i);
+		__m128 px = _mm_mul_ps(a, _mm_sub_ps(c, e));
+		__m128 pz = _mm_mul_ps(_mm_mul_ps(a, _mm_sqrt_ps(_mm_sub_ps(one, _mm_mul_ps(e, e)))), s);
+		__m128 wc = _mm_loadu_ps(periapsisCos + i);
+		__m128 ws = _mm_loadu_ps(periapsisSin + i);
+		_mm_storeu_ps(x + i, _mm_sub_ps(_mm_mul_ps(px, wc), _mm_mul_ps(pz, ws)));
+		_mm_storeu_ps(z + i, _mm_add_ps(_mm_mul_ps(px, ws), _mm_mul_ps(pz, wc)));
+	}
+#endif
+	SolveOrbitsScalar(meanAnomaly + i, semiMajor + i, eccentricity + i, periapsisCos + i, periapsisSin + i,
+		x + i, z + i, count - i);
+}
+
+const char* OrbitKernelName()
+{
+	return SIMD_NAME;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+// Most eccentric orbit the solver reaches float precision on, closer to 1 it no longer converges
+const float MaxOrbitEccentricity = 0.99f;
+
+// Positions of bodies on Keplerian orbits, over structure-of-arrays elements.
+// For each body Kepler's equation M = E - e sin E is solved for the eccentric anomaly
+// by Newton's method, then the offset from the focus is written to x and z (the orbital
+// plane), rotated so the periapsis lies at the given angle. Mean anomalies are in
+// radians and expected in [0, 2pi); eccentricities in [0, MaxOrbitEccentricity].
+void SolveOrbits(const float* meanAnomaly, const float* semiMajor, const float* eccentricity,
+	const float* periapsisCos, const float* periapsisSin, float* x, float* z, size_t count);
+// Same solve one body at a time, used for the tail of the SIMD loop and as a reference
+void SolveOrbitsScalar(const float* meanAnomaly, const float* semiMajor, const float* eccentricity,
+	const float* periapsisCos, const float* periapsisSin, float* x, float* z, size_t count);
+// Instruction set SolveOrbits was compiled for
+const char* OrbitKernelName();
@@ -0,0 +1,118 @@
+#include "ParticleSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "ShaderLibrary.h"
+
+// A thousand Earth years, short enough for 32-bit multiples to reach the fastest ring particles
+const double ParticleSystem::BasePeriod = 6000.0;
+const float ParticleSystem::MaxEccentricity = 0.1f;
+
+namespace
+{
+	const double TwoPi = 6.283185307179586;
+	// 2^32, one turn in the fixed point angles
+	const double Turn = 4294967296.0;
+}
+
+ParticleSystem::ParticleSystem()
+	: shader(ShaderLibrary::Get("particle.vert.glsl", "particle.frag.glsl"))
+{
+
+}
+
+ParticleSystem::~ParticleSystem()
+{
+	for (auto& field : fields)
+	{
+		glDeleteVertexArrays(1, &field.VAO);
+		glDeleteBuffers(1, &field.VBO);
+	}
+}
+
+size_t ParticleSystem::AddField(int focus, size_t count, float innerRadius, float outerRadius, float speed,
+	float thickness, float maxEccentricity, float particleSize, glm::vec3 color, float tilt, unsigned seed)
+{
+	// Fixed seed, the same scene gives the same belt every run
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	double baseSpeed = 360.0 / BasePeriod;
+	maxEccentricity = std::min(std::max(maxEccentricity, 0.0f), MaxEccentricity);
+	std::vector<ParticleVertex> particles(count);
+	for (auto& particle : particles)
+	{
+		// Uniform over the area of the annulus rather than the radius
+		float a = std::sqrt(innerRadius * innerRadius + unit(random) * (outerRadius * outerRadius - innerRadius * innerRadius));
+		double motion = speed * std::pow(a / innerRadius, -1.5f) / baseSpeed;
+		particle.anomaly = (GLuint)(unit(random) * Turn);
+		particle.motion = motion < 1.0 ? 1u : (GLuint)(motion + 0.5);
+		particle.semiMajor = a;
+		particle.eccentricity = unit(random) * maxEccentricity;
+		particle.periapsis = (float)(unit(random) * TwoPi);
+		particle.height = (unit(random) * 2.0f - 1.0f) * thickness * 0.5f;
+		particle.size = particleSize * (0.5f + unit(random));
+		particle.shade = 0.6f + 0.4f * unit(random);
+	}
+
+	Field field;
+	field.focus = focus;
+	field.tilt = glm::rotate(glm::mat4(1.0f), glm::radians(tilt), glm::vec3(1.0f, 0.0f, 0.0f));
+	field.color = color;
+	field.count = (GLsizei)count;
+
+	glGenVertexArrays(1, &field.VAO);
+	glGenBuffers(1, &field.VBO);
+	glBindVertexArray(field.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, field.VBO);
+	// Never touched again, the orbits are evaluated on the GPU
+	glBufferData(GL_ARRAY_BUFFER, particles.size() * sizeof(ParticleVertex), particles.empty() ? NULL : &particles.front(), GL_STATIC_DRAW);
+	glVertexAttribIPointer(0, 2, GL_UNSIGNED_INT, sizeof(ParticleVertex), (GLvoid*)offsetof(ParticleVertex, anomaly));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (GLvoid*)offsetof(ParticleVertex, semiMajor));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (GLvoid*)offsetof(ParticleVertex, size));
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	fields.push_back(field);
+	return fields.size() - 1;
+}
+
+void ParticleSystem::Draw(const Snapshot& state, float alpha)
+{
+	if (fields.empty())
+		return;
+
+	// Turns of the base motion since t = 0, reduced in double precision. A particle moving k times
+	// faster is k times further along, which the shader gets by wrapping 32-bit multiplication.
+	double turns = state.Time(alpha) / BasePeriod;
+	double phase = (turns - std::floor(turns)) * Turn;
+
+	shader->Use();
+	glUniform1ui(shader->Uniform("phase"), (GLuint)phase);
+	for (auto& field : fields)
+	{
+		glm::mat4 frame = glm::translate(glm::mat4(1.0f), state.Position(field.focus, alpha)) * field.tilt;
+		glUniformMatrix4fv(shader->Uniform("frame"), 1, GL_FALSE, glm::value_ptr(frame));
+		glUniform3f(shader->Uniform("color"), field.color.x, field.color.y, field.color.z);
+		glBindVertexArray(field.VAO);
+		glDrawArrays(GL_POINTS, 0, field.count);
+	}
+	glBindVertexArray(0);
+}
+
+size_t ParticleSystem::Size() const
+{
+	size_t size = 0;
+	for (auto& field : fields)
+		size += field.count;
+	return size;
+}
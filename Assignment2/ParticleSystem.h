@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "Snapshot.h"
+
+// Orbital elements of one particle, as streamed to particle.vert.glsl. The mean anomaly
+// and mean motion are fixed point so the shader can advance them with exact integer
+// wrap-around, however far the clock is from t = 0.
+struct ParticleVertex
+{
+	GLuint anomaly;      // mean anomaly at t = 0, in 2^-32 turns
+	GLuint motion;       // mean motion, in whole turns per ParticleSystem::BasePeriod
+	GLfloat semiMajor;
+	GLfloat eccentricity;
+	GLfloat periapsis;   // radians
+	GLfloat height;      // largest distance from the orbital plane
+	GLfloat size;        // diameter in scene units
+	GLfloat shade;       // brightness multiplier of the field's color
+};
+
+// Large numbers of small bodies (asteroid belts, planetary rings) drawn as point sprites.
+// Each field is generated once into a static vertex buffer and the vertex shader evaluates
+// every orbit from the time, so a frame only costs one uniform update and one draw per field.
+class ParticleSystem
+{
+public:
+	// Every particle's mean motion is a whole number of turns per BasePeriod simulated seconds
+	static const double BasePeriod;
+	// The vertex shader expands orbits to first order in the eccentricity, which only holds up to here
+	static const float MaxEccentricity;
+
+	ParticleSystem();
+	~ParticleSystem();
+
+	// Adds count particles orbiting the given hierarchy node between the two radii, returns the
+	// field's index. speed is the mean motion at the inner radius in degrees per simulated second,
+	// outer particles are slowed down following Kepler's third law. The field is tilted by tilt
+	// degrees about the x axis of the focus.
+	size_t AddField(int focus, size_t count, float innerRadius, float outerRadius, float speed,
+		float thickness, float maxEccentricity, float particleSize, glm::vec3 color, float tilt = 0.0f,
+		unsigned seed = 1);
+	// Draws every field around its focus as published in state, blended by alpha like the bodies
+	void Draw(const Snapshot& state, float alpha);
+
+	// Particles over all fields
+	size_t Size() const;
+private:
+	struct Field
+	{
+		int focus;
+		glm::mat4 tilt;
+		glm::vec3 color;
+		GLuint VAO, VBO;
+		GLsizei count;
+	};
+
+	std::shared_ptr<Shader> shader;
+	std::vector<Field> fields;
+};
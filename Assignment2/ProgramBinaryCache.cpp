@@ -0,0 +1,126 @@
+#include "ProgramBinaryCache.h"
+#include "Hash.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	const uint32_t CacheMagic = 0x4e494250; // "PBIN"
+	const uint32_t CacheVersion = 1;
+
+	struct CacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t format;
+		uint32_t length;
+	};
+
+	uint64_t Fnv1a(uint64_t hash, const std::string& str)
+	{
+		// Hash the terminator too so "ab"+"c" and "a"+"bc" differ
+		return ::Fnv1a(hash, str.c_str(), str.size() + 1);
+	}
+
+	std::string GLString(GLenum name)
+	{
+		const GLubyte* str = glGetString(name);
+		return str ? std::string(reinterpret_cast<const char*>(str)) : std::string();
+	}
+}
+
+std::string ProgramBinaryCache::Directory = "shadercache";
+
+bool ProgramBinaryCache::Available()
+{
+	if (!GLAD_GL_VERSION_4_1)
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+uint64_t ProgramBinaryCache::Key(const std::string& vertexCode, const std::string& fragmentCode, const std::string& defines)
+{
+	uint64_t hash = Fnv1aOffset;
+	hash = Fnv1a(hash, vertexCode);
+	hash = Fnv1a(hash, fragmentCode);
+	hash = Fnv1a(hash, defines);
+	hash = Fnv1a(hash, GLString(GL_VENDOR));
+	hash = Fnv1a(hash, GLString(GL_RENDERER));
+	hash = Fnv1a(hash, GLString(GL_VERSION));
+	return hash;
+}
+
+std::string ProgramBinaryCache::Path(uint64_t key)
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return Directory + "/" + name;
+}
+
+GLuint ProgramBinaryCache::Load(uint64_t key)
+{
+	std::ifstream file(Path(key), std::ios::binary);
+	if (!file)
+		return 0;
+
+	CacheHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+		|| header.magic != CacheMagic || header.version != CacheVersion || header.key != key)
+		return 0;
+
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), binary.size()))
+		return 0;
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), header.length);
+	GLint success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		// The driver rejected the binary (e.g. after an update), the caller recompiles
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+void ProgramBinaryCache::Store(uint64_t key, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	CacheHeader header = { CacheMagic, CacheVersion, key, 0, 0 };
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &header.format, binary.data());
+	header.length = written;
+
+#ifdef _WIN32
+	_mkdir(Directory.c_str());
+#else
+	mkdir(Directory.c_str(), 0755);
+#endif
+	std::ofstream file(Path(key), std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "ERROR::SHADER::CACHE::WRITE_FAILED " << Path(key) << std::endl;
+		return;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), written);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// Persists linked program binaries on disk (glGetProgramBinary / glProgramBinary).
+// Entries are keyed by a hash of the shader sources, the defines and the driver
+// strings, so a driver update or an edited shader simply misses the cache.
+class ProgramBinaryCache
+{
+public:
+	// True when the current context can save and reload program binaries
+	static bool Available();
+	// Builds the cache key for a program from its sources and defines
+	static uint64_t Key(const std::string& vertexCode, const std::string& fragmentCode, const std::string& defines);
+	// Creates a program from the cached binary, returns 0 if missing or stale
+	static GLuint Load(uint64_t key);
+	// Writes the binary of a linked program to the cache
+	static void Store(uint64_t key, GLuint program);
+
+	// Directory holding the cached binaries
+	static std::string Directory;
+private:
+	ProgramBinaryCache() {}
+	static std::string Path(uint64_t key);
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Entities are plain ids, their data lives in one pool per component type
+typedef uint32_t Entity;
+const Entity NoEntity = 0xffffffff;
+
+// Sparse set: components are packed in a dense array, with a sparse array mapping each entity to
+// its slot. Iterating the dense array touches only this component type, lookups are two indexings.
+// Removal moves the last component into the hole, so the order is not stable.
+template <typename T>
+class ComponentPool
+{
+public:
+	T& Add(Entity entity, const T& component)
+	{
+		if (entity >= sparse.size())
+			sparse.resize(entity + 1, NoSlot);
+		if (sparse[entity] != NoSlot)
+			return components[sparse[entity]] = component;
+		sparse[entity] = (uint32_t)components.size();
+		entities.push_back(entity);
+		components.push_back(component);
+		return components.back();
+	}
+	void Remove(Entity entity)
+	{
+		if (!Has(entity))
+			return;
+		uint32_t slot = sparse[entity];
+		components[slot] = std::move(components.back());
+		entities[slot] = entities.back();
+		sparse[entities[slot]] = slot;
+		components.pop_back();
+		entities.pop_back();
+		sparse[entity] = NoSlot;
+	}
+	bool Has(Entity entity) const { return entity < sparse.size() && sparse[entity] != NoSlot; }
+	T& Get(Entity entity) { return components[sparse[entity]]; }
+	const T& Get(Entity entity) const { return components[sparse[entity]]; }
+
+	size_t Size() const { return components.size(); }
+	// Entity owning each dense slot, in the same order as Components()
+	const std::vector<Entity>& Entities() const { return entities; }
+	std::vector<T>& Components() { return components; }
+	const std::vector<T>& Components() const { return components; }
+private:
+	static const uint32_t NoSlot = 0xffffffff;
+
+	std::vector<uint32_t> sparse; // slot of each entity, or NoSlot
+	std::vector<Entity> entities;
+	std::vector<T> components;
+};
+
+template <typename T>
+const uint32_t ComponentPool<T>::NoSlot;
+
+// Owns the entity ids and one ComponentPool per listed component type
+template <typename... Types>
+class Registry
+{
+public:
+	Registry() : nextEntity(0) {}
+
+	// New entity without components, ids of destroyed entities are reused
+	Entity Create()
+	{
+		if (freeEntities.empty())
+			return nextEntity++;
+		Entity entity = freeEntities.back();
+		freeEntities.pop_back();
+		return entity;
+	}
+	// Removes every component of the entity and frees its id
+	void Destroy(Entity entity)
+	{
+		int removed[] = { (Pool<Types>().Remove(entity), 0)... };
+		(void)removed;
+		freeEntities.push_back(entity);
+	}
+
+	template <typename T> ComponentPool<T>& Pool() { return std::get<ComponentPool<T>>(pools); }
+	template <typename T> const ComponentPool<T>& Pool() const { return std::get<ComponentPool<T>>(pools); }
+	template <typename T> T& Add(Entity entity, const T& component) { return Pool<T>().Add(entity, component); }
+	template <typename T> T& Get(Entity entity) { return Pool<T>().Get(entity); }
+	template <typename T> bool Has(Entity entity) const { return Pool<T>().Has(entity); }
+
+	// Calls fn(entity, T&, Others&...) for every entity that has all the listed components.
+	// Walks the dense array of T, so T should be the rarest of them.
+	template <typename T, typename... Others, typename F>
+	void Each(F fn)
+	{
+		ComponentPool<T>& pool = Pool<T>();
+		for (size_t i = 0; i < pool.Size(); i++)
+		{
+			Entity entity = pool.Entities()[i];
+			if (HasAll<Others...>(entity))
+				fn(entity, pool.Components()[i], Pool<Others>().Get(entity)...);
+		}
+	}
+private:
+	template <typename... Ts>
+	bool HasAll(Entity entity) const
+	{
+		bool has[] = { true, Has<Ts>(entity)... };
+		for (bool h : has)
+			if (!h)
+				return false;
+		return true;
+	}
+
+	std::tuple<ComponentPool<Types>...> pools;
+	std::vector<Entity> freeEntities;
+	Entity nextEntity;
+};
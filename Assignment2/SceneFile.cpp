@@ -0,0 +1,395 @@
+#include "SceneFile.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "BodySystems.h"
+#include "Hash.h"
+#include "MaterialLibrary.h"
+#include "MeshCache.h"
+#include "OrbitKernel.h"
+
+namespace
+{
+	const uint32_t SceneMagic = 0x454e4353; // "SCNE"
+	const uint32_t SceneVersion = 1;
+	const uint32_t NoName = 0xffffffff;
+
+	struct SceneHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceHash; // of the text the file was compiled from
+		uint32_t bodyCount;
+		uint32_t fieldCount;
+		uint32_t materialCount;
+		uint32_t stringBytes;
+	};
+
+	struct SceneField
+	{
+		int32_t focus;    // body index
+		uint32_t count;
+		float innerRadius, outerRadius, speed, thickness, maxEccentricity, size;
+		float color[3];
+		float tilt;
+		uint32_t seed;
+	};
+
+	// Byte offset of every section. Doubles come first.
+	struct SceneLayout
+	{
+		size_t meanAnomalyAtEpoch, meanMotion, spinSpeed;
+		size_t semiMajor, eccentricity, periapsisCos, periapsisSin, mass, radius;
+		size_t parent, material, name, mesh, up;
+		size_t fields, materials, strings;
+		size_t size;
+	};
+
+	SceneLayout Layout(const SceneHeader& header)
+	{
+		size_t n = header.bodyCount;
+		FileSections sections(sizeof(SceneHeader));
+		SceneLayout layout;
+		layout.meanAnomalyAtEpoch = sections.Add<double>(n);
+		layout.meanMotion = sections.Add<double>(n);
+		layout.spinSpeed = sections.Add<double>(n);
+		layout.semiMajor = sections.Add<float>(n);
+		layout.eccentricity = sections.Add<float>(n);
+		layout.periapsisCos = sections.Add<float>(n);
+		layout.periapsisSin = sections.Add<float>(n);
+		layout.mass = sections.Add<float>(n);
+		layout.radius = sections.Add<float>(n);
+		layout.parent = sections.Add<int32_t>(n);
+		layout.material = sections.Add<uint32_t>(n);
+		layout.name = sections.Add<uint32_t>(n);
+		layout.mesh = sections.Add<uint32_t>(n);      // sectors | stacks << 16
+		layout.up = sections.Add<uint8_t>(n);
+		layout.fields = sections.Add<SceneField>(header.fieldCount);
+		layout.materials = sections.Add<uint32_t>(header.materialCount);
+		layout.strings = sections.Add<char>(header.stringBytes);
+		layout.size = sections.Size();
+		return layout;
+	}
+
+	bool HashText(const std::string& path, uint64_t& hash)
+	{
+		MappedFile text;
+		if (!text.Open(path))
+			return false;
+		hash = Fnv1a(Fnv1aOffset, text.Data(), text.Size());
+		return true;
+	}
+
+	// Reads an optional value at the end of a line: it may be absent, but if present it has to parse
+	template <typename T>
+	bool Optional(std::istringstream& tokens, T& value)
+	{
+		tokens >> std::ws;
+		return tokens.eof() || (bool)(tokens >> value);
+	}
+
+	// Nothing may follow the last value of a line
+	bool AtEnd(std::istringstream& tokens)
+	{
+		tokens >> std::ws;
+		return tokens.eof();
+	}
+
+	bool EndsWith(const std::string& text, const std::string& suffix)
+	{
+		return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	// Appends a null terminated string, returns its offset
+	uint32_t AddString(std::vector<char>& strings, const std::string& text)
+	{
+		uint32_t offset = (uint32_t)strings.size();
+		strings.insert(strings.end(), text.begin(), text.end());
+		strings.push_back('\0');
+		return offset;
+	}
+}
+
+SceneFile::SceneFile()
+{
+
+}
+
+bool SceneFile::Open(const std::string& path)
+{
+	Close();
+	std::string binaryPath = path;
+	if (EndsWith(path, ".scene"))
+	{
+		binaryPath = path + ".bin";
+		uint64_t hash;
+		if (!HashText(path, hash))
+		{
+			std::cout << "ERROR::SCENE::FILE_NOT_FOUND " << path << std::endl;
+			return false;
+		}
+		// Recompile when the binary is missing, from another version or from another text
+		SceneHeader header;
+		bool current = file.Open(binaryPath) && file.Size() >= sizeof(header);
+		if (current)
+		{
+			memcpy(&header, file.Data(), sizeof(header));
+			current = header.magic == SceneMagic && header.version == SceneVersion && header.sourceHash == hash;
+		}
+		file.Close();
+		if (!current && !Compile(path, binaryPath))
+			return false;
+	}
+	if (!file.Open(binaryPath) || !Validate())
+	{
+		std::cout << "ERROR::SCENE::INVALID_FILE " << binaryPath << std::endl;
+		file.Close();
+		return false;
+	}
+	return true;
+}
+
+void SceneFile::Close()
+{
+	file.Close();
+}
+
+size_t SceneFile::BodyCount() const
+{
+	return file.IsOpen() ? Section<SceneHeader>(0)->bodyCount : 0;
+}
+
+uint64_t SceneFile::SourceHash() const
+{
+	return file.IsOpen() ? Section<SceneHeader>(0)->sourceHash : 0;
+}
+
+bool SceneFile::Validate() const
+{
+	if (file.Size() < sizeof(SceneHeader))
+		return false;
+	const SceneHeader& header = *Section<SceneHeader>(0);
+	if (header.magic != SceneMagic || header.version != SceneVersion)
+		return false;
+	SceneLayout layout = Layout(header);
+	if (file.Size() < layout.size)
+		return false;
+
+	// References are checked once here, loading then trusts them
+	const int32_t* parent = Section<int32_t>(layout.parent);
+	const uint32_t* material = Section<uint32_t>(layout.material);
+	const uint32_t* name = Section<uint32_t>(layout.name);
+	const uint32_t* mesh = Section<uint32_t>(layout.mesh);
+	const float* eccentricity = Section<float>(layout.eccentricity);
+	const uint32_t* materials = Section<uint32_t>(layout.materials);
+	const SceneField* fields = Section<SceneField>(layout.fields);
+	const char* strings = Section<char>(layout.strings);
+	if (header.stringBytes > 0 && strings[header.stringBytes - 1] != '\0')
+		return false;
+	for (uint32_t i = 0; i < header.bodyCount; i++)
+	{
+		if (parent[i] >= (int32_t)i || material[i] >= header.materialCount
+			|| (name[i] != NoName && name[i] >= header.stringBytes)
+			|| (mesh[i] & 0xffff) == 0 || (mesh[i] >> 16) == 0
+			|| !(eccentricity[i] >= 0.0f && eccentricity[i] <= MaxOrbitEccentricity))
+			return false;
+	}
+	for (uint32_t i = 0; i < header.materialCount; i++)
+		if (materials[i] >= header.stringBytes)
+			return false;
+	for (uint32_t i = 0; i < header.fieldCount; i++)
+	{
+		if (fields[i].focus < 0 || fields[i].focus >= (int32_t)header.bodyCount
+			|| !(fields[i].maxEccentricity >= 0.0f && fields[i].maxEccentricity <= ParticleSystem::MaxEccentricity))
+			return false;
+	}
+	return true;
+}
+
+size_t SceneFile::LoadBodies(TransformHierarchy& transforms, BodyStorage& bodies) const
+{
+	const SceneHeader& header = *Section<SceneHeader>(0);
+	SceneLayout layout = Layout(header);
+	int firstNode = transforms.AddRange(Section<int32_t>(layout.parent), header.bodyCount);
+	return bodies.Append(header.bodyCount, firstNode,
+		Section<float>(layout.semiMajor), Section<float>(layout.eccentricity),
+		Section<float>(layout.periapsisCos), Section<float>(layout.periapsisSin),
+		Section<double>(layout.meanAnomalyAtEpoch), Section<double>(layout.meanMotion),
+		Section<double>(layout.spinSpeed), Section<float>(layout.mass));
+}
+
+void SceneFile::Load(SceneRegistry& registry, TransformHierarchy& transforms, BodyStorage& bodies, ParticleSystem& particles) const
+{
+	const SceneHeader& header = *Section<SceneHeader>(0);
+	SceneLayout layout = Layout(header);
+	size_t firstBody = LoadBodies(transforms, bodies);
+
+	// Each material and tessellation is resolved once, not once per body
+	const char* strings = Section<char>(layout.strings);
+	const uint32_t* materialNames = Section<uint32_t>(layout.materials);
+	std::vector<Material> materials(header.materialCount);
+	for (uint32_t i = 0; i < header.materialCount; i++)
+		materials[i] = MaterialLibrary::Load(strings + materialNames[i]);
+	std::map<uint32_t, std::shared_ptr<const Mesh>> meshes;
+
+	const float* radius = Section<float>(layout.radius);
+	const uint32_t* material = Section<uint32_t>(layout.material);
+	const uint32_t* name = Section<uint32_t>(layout.name);
+	const uint32_t* mesh = Section<uint32_t>(layout.mesh);
+	const uint8_t* up = Section<uint8_t>(layout.up);
+	for (uint32_t i = 0; i < header.bodyCount; i++)
+	{
+		std::shared_ptr<const Mesh>& sphere = meshes[mesh[i]];
+		if (!sphere)
+			sphere = MeshCache::GetSphere(mesh[i] & 0xffff, mesh[i] >> 16);
+		size_t body = firstBody + i;
+		BodySystems::CreateEntity(registry, bodies.node[body], body, radius[i], sphere, materials[material[i]],
+			name[i] == NoName ? std::string() : std::string(strings + name[i]), up[i] != 0);
+	}
+
+	const SceneField* fields = Section<SceneField>(layout.fields);
+	for (uint32_t i = 0; i < header.fieldCount; i++)
+	{
+		const SceneField& field = fields[i];
+		particles.AddField(bodies.node[firstBody + field.focus], field.count, field.innerRadius, field.outerRadius,
+			field.speed, field.thickness, field.maxEccentricity, field.size,
+			glm::vec3(field.color[0], field.color[1], field.color[2]), field.tilt, field.seed);
+	}
+}
+
+bool SceneFile::Compile(const std::string& textPath, const std::string& binaryPath)
+{
+	uint64_t hash;
+	std::ifstream text(textPath);
+	if (!text || !HashText(textPath, hash))
+	{
+		std::cout << "ERROR::SCENE::FILE_NOT_FOUND " << textPath << std::endl;
+		return false;
+	}
+
+	std::vector<double> meanAnomalyAtEpoch, meanMotion, spinSpeed;
+	std::vector<float> semiMajor, eccentricity, periapsisCos, periapsisSin, mass, radius;
+	std::vector<int32_t> parent;
+	std::vector<uint32_t> material, name, mesh, materialNames;
+	std::vector<uint8_t> up;
+	std::vector<SceneField> fields;
+	std::vector<char> strings;
+	std::map<std::string, int32_t> bodyIndex;
+	std::map<std::string, uint32_t> materialIndex;
+
+	std::string line;
+	for (int lineNumber = 1; std::getline(text, line); lineNumber++)
+	{
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+		std::istringstream tokens(line);
+		std::string keyword;
+		if (!(tokens >> keyword))
+			continue;
+
+		bool valid = false;
+		if (keyword == "body")
+		{
+			std::string bodyName, focus, side, texture;
+			float bodyRadius, distance, startAngle, speed, bodyEccentricity = 0.0f, bodyMass = 0.0f, periapsis = 0.0f;
+			int sectors, stacks;
+			valid = (tokens >> bodyName >> bodyRadius >> sectors >> stacks >> focus >> distance >> startAngle >> speed >> side >> texture)
+				&& (side == "up" || side == "down") && sectors > 0 && sectors < 65536 && stacks > 0 && stacks < 65536
+				&& (focus == "-" || bodyIndex.count(focus) > 0) && bodyIndex.count(bodyName) == 0;
+			// Optional trailing values; the Kepler solver only converges up to MaxOrbitEccentricity
+			valid = valid && Optional(tokens, bodyEccentricity) && Optional(tokens, bodyMass) && Optional(tokens, periapsis)
+				&& AtEnd(tokens)
+				&& bodyEccentricity >= 0.0f && bodyEccentricity <= MaxOrbitEccentricity;
+			if (valid)
+			{
+				uint32_t& materialId = materialIndex[texture];
+				if (materialId == 0)
+				{
+					materialNames.push_back(AddString(strings, texture));
+					materialId = (uint32_t)materialNames.size();
+				}
+				bodyIndex[bodyName] = (int32_t)parent.size();
+				// Stored already converted, so loading is a plain copy
+				BodyStorage::Elements elements = BodyStorage::Convert(focus == "-" ? 0.0f : distance, startAngle, speed,
+					BodySystems::SpinSpeed, bodyEccentricity, periapsis);
+				meanAnomalyAtEpoch.push_back(elements.meanAnomalyAtEpoch);
+				meanMotion.push_back(elements.meanMotion);
+				spinSpeed.push_back(elements.spinSpeed);
+				semiMajor.push_back(elements.semiMajor);
+				eccentricity.push_back(elements.eccentricity);
+				periapsisCos.push_back(elements.periapsisCos);
+				periapsisSin.push_back(elements.periapsisSin);
+				mass.push_back(bodyMass);
+				radius.push_back(bodyRadius);
+				parent.push_back(focus == "-" ? TransformHierarchy::NoParent : bodyIndex[focus]);
+				material.push_back(materialId - 1);
+				name.push_back(AddString(strings, bodyName));
+				mesh.push_back((uint32_t)sectors | (uint32_t)stacks << 16);
+				up.push_back(side == "up" ? 1 : 0);
+			}
+		}
+		else if (keyword == "field")
+		{
+			std::string focus;
+			SceneField field = SceneField();
+			field.seed = 1;
+			valid = (tokens >> focus >> field.count >> field.innerRadius >> field.outerRadius >> field.speed >> field.thickness
+				>> field.maxEccentricity >> field.size >> field.color[0] >> field.color[1] >> field.color[2])
+				&& bodyIndex.count(focus) > 0 && field.innerRadius > 0.0f && field.outerRadius >= field.innerRadius
+				&& field.maxEccentricity >= 0.0f && field.maxEccentricity <= ParticleSystem::MaxEccentricity;
+			unsigned seed = field.seed;
+			valid = valid && Optional(tokens, field.tilt) && Optional(tokens, seed) && AtEnd(tokens);
+			field.seed = seed;
+			if (valid)
+			{
+				field.focus = bodyIndex[focus];
+				fields.push_back(field);
+			}
+		}
+		if (!valid)
+		{
+			std::cout << "ERROR::SCENE::SYNTAX " << textPath << ":" << lineNumber << ": " << line << std::endl;
+			return false;
+		}
+	}
+
+	SceneHeader header = { SceneMagic, SceneVersion, hash, (uint32_t)parent.size(), (uint32_t)fields.size(),
+		(uint32_t)materialNames.size(), (uint32_t)strings.size() };
+	SceneLayout layout = Layout(header);
+	std::vector<unsigned char> image(layout.size, 0);
+	memcpy(&image.front(), &header, sizeof(header));
+	WriteSection(image, layout.meanAnomalyAtEpoch, meanAnomalyAtEpoch);
+	WriteSection(image, layout.meanMotion, meanMotion);
+	WriteSection(image, layout.spinSpeed, spinSpeed);
+	WriteSection(image, layout.semiMajor, semiMajor);
+	WriteSection(image, layout.eccentricity, eccentricity);
+	WriteSection(image, layout.periapsisCos, periapsisCos);
+	WriteSection(image, layout.periapsisSin, periapsisSin);
+	WriteSection(image, layout.mass, mass);
+	WriteSection(image, layout.radius, radius);
+	WriteSection(image, layout.parent, parent);
+	WriteSection(image, layout.material, material);
+	WriteSection(image, layout.name, name);
+	WriteSection(image, layout.mesh, mesh);
+	WriteSection(image, layout.up, up);
+	WriteSection(image, layout.fields, fields);
+	WriteSection(image, layout.materials, materialNames);
+	WriteSection(image, layout.strings, strings);
+
+	std::ofstream out(binaryPath, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(&image.front()), image.size());
+	out.close();
+	if (!out)
+	{
+		std::cout << "ERROR::SCENE::WRITE_FAILED " << binaryPath << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "BodyStorage.h"
+#include "Components.h"
+#include "FileSections.h"
+#include "MappedFile.h"
+#include "ParticleSystem.h"
+#include "TransformHierarchy.h"
+
+// Scenes are authored as text and loaded from a compiled binary that is memory-mapped and laid
+// out like BodyStorage, one array per element, so loading is one block copy per array.
+//
+// Text format, one statement per line, # starts a comment, names have no spaces:
+//   body <name> <radius> <sectors> <stacks> <focus|-> <distance> <startAngle> <speed> <up|down> <texture> [eccentricity] [mass] [periapsis]
+//   field <focus> <count> <innerRadius> <outerRadius> <speed> <thickness> <maxEccentricity> <size> <r> <g> <b> [tilt] [seed]
+// A focus must be declared before the bodies orbiting it. Angles are in degrees and speeds in
+// degrees per simulated second, as for BodySystems::CreateBody and ParticleSystem::AddField.
+// Eccentricities go up to MaxOrbitEccentricity for bodies and ParticleSystem::MaxEccentricity
+// for fields. A line with anything malformed or extra is a syntax error.
+class SceneFile
+{
+public:
+	SceneFile();
+
+	// Maps a compiled scene. A text scene (.scene) is compiled to <path>.bin first, unless that
+	// file is already up to date with the text.
+	bool Open(const std::string& path);
+	void Close();
+	size_t BodyCount() const;
+	// Hash of the text the open scene was compiled from, it changes with any edit
+	uint64_t SourceHash() const;
+
+	// Appends every body to the hierarchy and the body storage, returns the index of the first one
+	size_t LoadBodies(TransformHierarchy& transforms, BodyStorage& bodies) const;
+	// Loads the bodies, creates their entities and generates the particle fields (needs a GL context)
+	void Load(SceneRegistry& registry, TransformHierarchy& transforms, BodyStorage& bodies, ParticleSystem& particles) const;
+
+	// Compiles a text scene, reporting syntax errors with their line
+	static bool Compile(const std::string& textPath, const std::string& binaryPath);
+private:
+	SceneFile(const SceneFile&);
+	SceneFile& operator=(const SceneFile&);
+
+	// Checks the header, the section sizes and the references of the mapped file
+	bool Validate() const;
+	template <typename T> const T* Section(size_t offset) const { return SectionData<T>(file, offset); }
+
+	MappedFile file;
+};
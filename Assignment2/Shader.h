@@ -6,15 +6,22 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
 
 #include <glad/glad.h>
 
+#include "ProgramBinaryCache.h"
+
 class Shader
 {
 public:
+	// Binding point of the std140 "Camera" block (see CameraBuffer)
+	static const GLuint CameraBlockBinding = 0;
+
 	GLuint Program;
-	// Constructor generates the shader on the fly
-	Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
+	// Constructor generates the shader on the fly, or reloads it from the program binary cache.
+	// defines are inserted right after the #version line of both stages.
+	Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const std::string& defines = "")
 	{
 		// 1. Retrieve the vertex/fragment source code from filePath
 		std::string vertexCode;
@@ -37,16 +44,77 @@ public:
 			vShaderFile.close();
 			fShaderFile.close();
 			// Convert stream into string
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
+			vertexCode = InjectDefines(vShaderStream.str(), defines);
+			fragmentCode = InjectDefines(fShaderStream.str(), defines);
 		}
 		catch (std::ifstream::failure e)
 		{
 			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
 		}
+
+		// 2. Try the binary cache, the key covers sources, defines and driver
+		bool cacheable = ProgramBinaryCache::Available();
+		uint64_t key = 0;
+		this->Program = 0;
+		if (cacheable)
+		{
+			key = ProgramBinaryCache::Key(vertexCode, fragmentCode, defines);
+			this->Program = ProgramBinaryCache::Load(key);
+		}
+
+		// 3. Cache miss or stale entry: compile from source
+		if (this->Program == 0)
+		{
+			this->Program = Compile(vertexCode, fragmentCode, cacheable);
+			if (cacheable && this->Linked())
+				ProgramBinaryCache::Store(key, this->Program);
+		}
+
+		// 4. Attach the shared uniform blocks the program declares
+		GLuint cameraBlock = glGetUniformBlockIndex(this->Program, "Camera");
+		if (cameraBlock != GL_INVALID_INDEX)
+			glUniformBlockBinding(this->Program, cameraBlock, CameraBlockBinding);
+	}
+	// Uses the current shader
+	void Use()
+	{
+		glUseProgram(this->Program);
+	}
+	// Whether the program linked successfully
+	bool Linked() const
+	{
+		GLint success;
+		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+		return success != 0;
+	}
+	// Location of a uniform, queried from the driver only the first time it is asked for
+	GLint Uniform(const std::string& name)
+	{
+		auto it = Locations.find(name);
+		if (it != Locations.end())
+			return it->second;
+		GLint location = glGetUniformLocation(this->Program, name.c_str());
+		Locations.insert(std::make_pair(name, location));
+		return location;
+	}
+private:
+	std::unordered_map<std::string, GLint> Locations;
+
+	static std::string InjectDefines(const std::string& code, const std::string& defines)
+	{
+		if (defines.empty())
+			return code;
+		// #version must stay the first statement of the source
+		size_t eol = code.find('\n');
+		if (eol == std::string::npos)
+			return code + "\n" + defines + "\n";
+		return code.substr(0, eol + 1) + defines + "\n" + code.substr(eol + 1);
+	}
+
+	static GLuint Compile(const std::string& vertexCode, const std::string& fragmentCode, bool retrievable)
+	{
 		const GLchar* vShaderCode = vertexCode.c_str();
 		const GLchar* fShaderCode = fragmentCode.c_str();
-		// 2. Compile shaders
 		GLuint vertex, fragment;
 		GLint success;
 		GLchar infoLog[512];
@@ -73,26 +141,24 @@ public:
 			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
 		}
 		// Shader Program
-		this->Program = glCreateProgram();
-		glAttachShader(this->Program, vertex);
-		glAttachShader(this->Program, fragment);
-		glLinkProgram(this->Program);
+		GLuint program = glCreateProgram();
+		// Ask the driver to keep the binary around so it can be cached
+		if (retrievable)
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glAttachShader(program, vertex);
+		glAttachShader(program, fragment);
+		glLinkProgram(program);
 		// Print linking errors if any
-		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
 		if (!success)
 		{
-			glGetProgramInfoLog(this->Program, 512, NULL, infoLog);
+			glGetProgramInfoLog(program, 512, NULL, infoLog);
 			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
 		}
 		// Delete the shaders as they're linked into our program now and no longer necessery
 		glDeleteShader(vertex);
 		glDeleteShader(fragment);
-
-	}
-	// Uses the current shader
-	void Use()
-	{
-		glUseProgram(this->Program);
+		return program;
 	}
 };
 
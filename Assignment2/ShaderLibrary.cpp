@@ -0,0 +1,28 @@
+#include "ShaderLibrary.h"
+
+std::map<ShaderLibrary::Key, std::shared_ptr<Shader>> ShaderLibrary::Programs;
+
+std::shared_ptr<Shader> ShaderLibrary::Get(const std::string& vertexPath, const std::string& fragmentPath,
+	const std::string& defines)
+{
+	Key key(vertexPath, fragmentPath, defines);
+	auto it = Programs.find(key);
+	if (it != Programs.end())
+		return it->second;
+
+	std::shared_ptr<Shader> shader = std::make_shared<Shader>(vertexPath.c_str(), fragmentPath.c_str(), defines);
+	Programs.insert(std::make_pair(key, shader));
+	return shader;
+}
+
+size_t ShaderLibrary::Size()
+{
+	return Programs.size();
+}
+
+void ShaderLibrary::Clear()
+{
+	for (auto& it : Programs)
+		glDeleteProgram(it.second->Program);
+	Programs.clear();
+}
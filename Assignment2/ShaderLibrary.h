@@ -0,0 +1,27 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include "Shader.h"
+
+// Compiles each (vertex, fragment, defines) combination once and hands out shared handles to it.
+// Every program created here stays owned by the library until Clear() is called.
+class ShaderLibrary
+{
+public:
+	// Returns the program built from the given sources, compiling it on first use
+	static std::shared_ptr<Shader> Get(const std::string& vertexPath, const std::string& fragmentPath,
+		const std::string& defines = "");
+	// Number of programs currently owned by the library
+	static size_t Size();
+	// Deletes every program owned by the library (needs a current GL context)
+	static void Clear();
+private:
+	ShaderLibrary() {}
+
+	typedef std::tuple<std::string, std::string, std::string> Key;
+	static std::map<Key, std::shared_ptr<Shader>> Programs;
+};
@@ -0,0 +1,102 @@
+#include <cmath>
+
+#include "SignedDistanceField.h"
+
+namespace
+{
+	// Offset to the nearest seed pixel
+	struct Offset
+	{
+		int dx, dy;
+		int Distance2() const { return dx * dx + dy * dy; }
+	};
+
+	const Offset Far = { 1 << 14, 1 << 14 };
+
+	class Grid
+	{
+	public:
+		Grid(int width, int height) : width(width), height(height), cells((size_t)width * height, Far) {}
+
+		Offset& At(int x, int y) { return cells[(size_t)y * width + x]; }
+
+		// Pixels outside the grid count as empty
+		Offset Get(int x, int y) const
+		{
+			if (x < 0 || y < 0 || x >= width || y >= height)
+				return Far;
+			return cells[(size_t)y * width + x];
+		}
+
+		void Compare(Offset& best, int x, int y, int ox, int oy) const
+		{
+			Offset other = Get(x + ox, y + oy);
+			other.dx += ox;
+			other.dy += oy;
+			if (other.Distance2() < best.Distance2())
+				best = other;
+		}
+
+		// Two raster passes propagating offsets from already visited neighbours
+		void Propagate()
+		{
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					Offset& p = At(x, y);
+					Compare(p, x, y, -1, 0);
+					Compare(p, x, y, 0, -1);
+					Compare(p, x, y, -1, -1);
+					Compare(p, x, y, 1, -1);
+				}
+				for (int x = width - 1; x >= 0; x--)
+					Compare(At(x, y), x, y, 1, 0);
+			}
+			for (int y = height - 1; y >= 0; y--)
+			{
+				for (int x = width - 1; x >= 0; x--)
+				{
+					Offset& p = At(x, y);
+					Compare(p, x, y, 1, 0);
+					Compare(p, x, y, 0, 1);
+					Compare(p, x, y, -1, 1);
+					Compare(p, x, y, 1, 1);
+				}
+				for (int x = 0; x < width; x++)
+					Compare(At(x, y), x, y, -1, 0);
+			}
+		}
+	private:
+		int width, height;
+		std::vector<Offset> cells;
+	};
+}
+
+std::vector<float> SignedDistance(const unsigned char* coverage, int width, int height)
+{
+	// inside: distance to the nearest inside pixel, outside: to the nearest outside pixel
+	Grid inside(width, height), outside(width, height);
+	const Offset zero = { 0, 0 };
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+		{
+			if (coverage[(size_t)y * width + x] >= 128)
+				inside.At(x, y) = zero;
+			else
+				outside.At(x, y) = zero;
+		}
+	inside.Propagate();
+	outside.Propagate();
+
+	// Offsets are between pixel centres, the edge itself lies half a pixel closer
+	std::vector<float> distance((size_t)width * height);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+		{
+			float toOutside = std::sqrt((float)outside.At(x, y).Distance2());
+			float toInside = std::sqrt((float)inside.At(x, y).Distance2());
+			distance[(size_t)y * width + x] = toInside == 0.0f ? toOutside - 0.5f : 0.5f - toInside;
+		}
+	return distance;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <vector>
+
+// Signed distance in pixels from each pixel centre to the nearest edge of a coverage
+// bitmap (pixels >= 128 are inside), positive inside and negative outside.
+// Uses the 8-point sequential Euclidean distance transform (8SSEDT).
+std::vector<float> SignedDistance(const unsigned char* coverage, int width, int height);
@@ -0,0 +1,15 @@
+#pragma once
+
+// Instruction set the SIMD kernels are compiled for: AVX2 when the compiler targets it
+// (/arch:AVX2, -mavx2), otherwise SSE2 which every x64 CPU has, otherwise plain C++
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2
+#define SIMD_NAME "AVX2"
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#define SIMD_NAME "SSE2"
+#else
+#define SIMD_NAME "scalar"
+#endif
@@ -0,0 +1,191 @@
+#include "Simulation.h"
+
+#include <chrono>
+
+#include "JobSystem.h"
+
+const double Simulation::TickInterval = 1.0 / 60.0;
+
+Simulation::Simulation(TransformHierarchy& transforms, BodyStorage& bodies, double simulatedYear,
+	const std::string& checkpointPath, uint64_t sceneHash)
+	: transforms(transforms), bodies(bodies), simulatedYear(simulatedYear), checkpointPath(checkpointPath), gravityMode(false), speedScale(1.0f),
+	timeWarp(1.0), discontinuity(true), lastTime(0.0), checkpoint(sceneHash), running(false)
+{
+
+}
+
+Simulation::~Simulation()
+{
+	Stop();
+}
+
+void Simulation::Start()
+{
+	if (running)
+		return;
+	// The renderer has a complete state to draw before the first tick
+	Tick(0.0);
+	snapshots.Acquire();
+	running = true;
+	thread = std::thread(&Simulation::Run, this);
+}
+
+void Simulation::Stop()
+{
+	running = false;
+	if (thread.joinable())
+		thread.join();
+}
+
+bool Simulation::Post(SimulationCommand::Type type, double value)
+{
+	SimulationCommand command = { type, value };
+	return commands.Push(command);
+}
+
+const Snapshot& Simulation::Latest()
+{
+	snapshots.Acquire();
+	return snapshots.Front();
+}
+
+float Simulation::Alpha(const Snapshot& snapshot) const
+{
+	float alpha = (float)((Now() - snapshot.tickTime) / TickInterval);
+	return alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+}
+
+double Simulation::Now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Simulation::Run()
+{
+	// Loading time is not simulated
+	double last = Now();
+	double next = last + TickInterval;
+	while (running)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(next - Now()));
+		double now = Now();
+		Tick(now - last);
+		last = now;
+		// After a stall, tick again right away once instead of catching up with a burst
+		next += TickInterval;
+		if (next < now)
+			next = now + TickInterval;
+	}
+}
+
+void Simulation::Tick(double realSeconds)
+{
+	SimulationCommand command;
+	while (commands.Pop(command))
+		Execute(command);
+
+	int steps = clock.Advance(realSeconds, speedScale * timeWarp);
+
+	// Spins always come from the clock, orbits from the N-body steps when gravity is on.
+	// Gravity has to be integrated step by step, jumps only move the Kepler orbits.
+	double time = clock.Time();
+	JobSystem::Handle evaluated = JobSystem::Schedule([this, time]() { bodies.Evaluate(time); });
+	JobSystem::Handle simulated;
+	if (gravityMode)
+		simulated = JobSystem::Schedule([this, steps]() {
+			for (int i = 0; i < steps; i++)
+				gravity.Step((float)clock.Step());
+		});
+	JobSystem::Handle placed = JobSystem::Schedule([this]() {
+		if (gravityMode)
+			bodies.ApplyGravity(gravity, transforms);
+		else
+			bodies.Apply(transforms);
+		transforms.Update();
+	}, { evaluated, simulated });
+	JobSystem::Wait(placed);
+
+	Publish(!discontinuity);
+	discontinuity = false;
+}
+
+void Simulation::Execute(const SimulationCommand& command)
+{
+	switch (command.type)
+	{
+	case SimulationCommand::ChangeSpeed:
+		speedScale += (float)command.value;
+		speedScale = speedScale < 0.0f ? 0.0f : (speedScale > 2.0f ? 2.0f : speedScale);
+		break;
+	case SimulationCommand::ChangeWarp:
+		timeWarp *= command.value;
+		timeWarp = timeWarp < 1.0 ? 1.0 : (timeWarp > 1e6 ? 1e6 : timeWarp);
+		break;
+	case SimulationCommand::Jump:
+		clock.Seek(clock.Time() + command.value * simulatedYear);
+		discontinuity = true;
+		break;
+	case SimulationCommand::Reset:
+		clock.Seek(0.0);
+		discontinuity = true;
+		break;
+	case SimulationCommand::ToggleGravity:
+		// Starts from where the bodies were at the last tick
+		gravityMode = !gravityMode;
+		if (gravityMode)
+			bodies.ToGravity(transforms, gravity);
+		discontinuity = true;
+		break;
+	case SimulationCommand::SaveCheckpoint:
+	{
+		// Taken between two ticks, the bodies and the N-body state are at the same instant
+		CheckpointControls controls = { clock.Time(), speedScale, timeWarp, gravityMode };
+		checkpoint.Save(checkpointPath, bodies, transforms, gravityMode ? &gravity : nullptr, controls);
+		break;
+	}
+	case SimulationCommand::RestoreCheckpoint:
+	{
+		CheckpointControls controls;
+		if (checkpoint.Restore(checkpointPath, bodies, transforms, gravity, controls))
+		{
+			clock.Seek(controls.time);
+			speedScale = controls.speedScale;
+			timeWarp = controls.timeWarp;
+			gravityMode = controls.gravity;
+			discontinuity = true;
+		}
+		break;
+	}
+	}
+}
+
+void Simulation::Publish(bool continuous)
+{
+	Snapshot& snapshot = snapshots.Back();
+	snapshot.position.resize(transforms.Size());
+	for (size_t node = 0; node < transforms.Size(); node++)
+		snapshot.position[node] = transforms.WorldPosition((int)node);
+	snapshot.spin = bodies.spin;
+	snapshot.time = clock.Time();
+	if (continuous)
+	{
+		snapshot.previousPosition = lastPosition;
+		snapshot.previousSpin = lastSpin;
+		snapshot.previousTime = lastTime;
+	}
+	else
+	{
+		snapshot.previousPosition = snapshot.position;
+		snapshot.previousSpin = snapshot.spin;
+		snapshot.previousTime = snapshot.time;
+	}
+	snapshot.tickTime = Now();
+	snapshot.speedScale = speedScale;
+	snapshot.timeWarp = timeWarp;
+	snapshot.gravity = gravityMode;
+
+	lastPosition = snapshot.position;
+	lastSpin = snapshot.spin;
+	lastTime = snapshot.time;
+	snapshots.Publish();
+}
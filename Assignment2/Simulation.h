@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BodyStorage.h"
+#include "Checkpoint.h"
+#include "NBodySystem.h"
+#include "SimulationClock.h"
+#include "Snapshot.h"
+#include "SpscQueue.h"
+#include "TransformHierarchy.h"
+#include "TripleBuffer.h"
+
+// Input for the simulation thread, sent by the thread handling the keys
+struct SimulationCommand
+{
+	enum Type
+	{
+		ChangeSpeed,      // adds value to the speed scale, kept within [0, 2]
+		ChangeWarp,       // multiplies the time warp by value, kept within [1, 1e6]
+		Jump,             // moves value simulated years forward or back
+		Reset,            // back to year 0
+		ToggleGravity,    // switches between the Kepler orbits and the N-body simulation
+		SaveCheckpoint,   // writes the current state to the checkpoint file
+		RestoreCheckpoint // goes back to the state saved in the checkpoint file
+	};
+	Type type;
+	double value;
+};
+
+// Runs the bodies on their own thread at a fixed tick, so a slow frame no longer holds up the
+// simulation and a slow tick no longer holds up drawing. Every tick publishes a Snapshot through
+// a triple buffer; commands come in through a lock-free queue. The hierarchy and the bodies
+// belong to the simulation thread between Start() and Stop().
+class Simulation
+{
+public:
+	// Real seconds between two ticks
+	static const double TickInterval;
+
+	// Checkpoints are saved to and restored from checkpointPath, and only restored over the
+	// scene with the SceneFile::SourceHash sceneHash
+	Simulation(TransformHierarchy& transforms, BodyStorage& bodies, double simulatedYear,
+		const std::string& checkpointPath, uint64_t sceneHash);
+	~Simulation();
+
+	// Publishes the initial state, then starts ticking
+	void Start();
+	void Stop();
+
+	// Queues a command for the next tick, false when the queue is full
+	bool Post(SimulationCommand::Type type, double value = 0.0);
+
+	// Newest complete snapshot, never blocks. Only for the rendering thread.
+	const Snapshot& Latest();
+	// Blend factor that renders the snapshot one tick behind real time, which keeps motion smooth
+	float Alpha(const Snapshot& snapshot) const;
+
+	// Real seconds on the clock the ticks are timed with
+	static double Now();
+private:
+	void Run();
+	void Tick(double realSeconds);
+	void Execute(const SimulationCommand& command);
+	void Publish(bool continuous);
+
+	TransformHierarchy& transforms;
+	BodyStorage& bodies;
+	double simulatedYear;
+	std::string checkpointPath;
+
+	// Only touched by the simulation thread once started
+	SimulationClock clock;
+	NBodySystem gravity;
+	bool gravityMode;
+	float speedScale;
+	double timeWarp;
+	bool discontinuity;    // the next snapshot must not blend with the previous one
+	std::vector<glm::vec3> lastPosition;
+	std::vector<float> lastSpin;
+	double lastTime;
+	Checkpoint checkpoint;
+
+	SpscQueue<SimulationCommand, 64> commands;
+	TripleBuffer<Snapshot> snapshots;
+	std::atomic<bool> running;
+	std::thread thread;
+};
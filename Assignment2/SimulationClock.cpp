@@ -0,0 +1,33 @@
+#include "SimulationClock.h"
+
+#include <cmath>
+
+SimulationClock::SimulationClock(double step) : step(step), accumulator(0.0), time(0.0)
+{
+
+}
+
+int SimulationClock::Advance(double realSeconds, double timeScale)
+{
+	if (realSeconds < 0.0 || timeScale <= 0.0)
+		return 0;
+	time += realSeconds * timeScale;
+	accumulator += realSeconds * timeScale;
+
+	int steps = 0;
+	while (accumulator >= step && steps < MaxSteps)
+	{
+		accumulator -= step;
+		steps++;
+	}
+	// After a stall (window dragged, breakpoint) or under heavy time warp skip ahead rather than replay it
+	if (accumulator >= step)
+		accumulator = std::fmod(accumulator, step);
+	return steps;
+}
+
+void SimulationClock::Seek(double t)
+{
+	time = t;
+	accumulator = 0.0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Simulation time source. Time() follows real frame time scaled by the simulation
+// speed exactly, for systems evaluated analytically. Stepped systems consume the same
+// time in whole steps of Step() simulated seconds; what is left over gives the
+// interpolation factor between their last two steps.
+class SimulationClock
+{
+public:
+	explicit SimulationClock(double step = 1.0 / 60.0);
+
+	// Adds a frame's real duration, returns how many steps to simulate now
+	int Advance(double realSeconds, double timeScale);
+	// Jumps to a simulated time, stepped systems start again from a whole step
+	void Seek(double t);
+
+	// Length of a step in simulated seconds
+	double Step() const { return step; }
+	// Simulated seconds since start
+	double Time() const { return time; }
+	// Fraction of a step between the last two simulated states, in [0, 1)
+	float Alpha() const { return (float)(accumulator / step); }
+private:
+	// Beyond this many steps in one frame stepped systems skip time instead of falling behind for good
+	static const int MaxSteps = 8;
+
+	double step;
+	double accumulator;
+	double time;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// State of the scene at one simulation tick, as published to the renderer. It also keeps the
+// previous tick so the renderer can blend between the two; alpha 0 is the previous tick and 1
+// the newest. Once published a snapshot is never modified while the renderer holds it.
+struct Snapshot
+{
+	std::vector<glm::vec3> previousPosition, position; // world position of every hierarchy node
+	std::vector<float> previousSpin, spin;             // rotation of every body, degrees
+	double previousTime, time;                         // simulated seconds
+	double tickTime;                                   // real seconds at which the tick ran
+
+	// Settings as the simulation applied them, for display
+	float speedScale;
+	double timeWarp;
+	bool gravity;
+
+	glm::vec3 Position(int node, float alpha) const
+	{
+		return previousPosition[node] + (position[node] - previousPosition[node]) * alpha;
+	}
+	float Spin(size_t body, float alpha) const
+	{
+		// Shortest way round, the angles wrap at 360
+		float delta = spin[body] - previousSpin[body];
+		if (delta > 180.0f)
+			delta -= 360.0f;
+		else if (delta < -180.0f)
+			delta += 360.0f;
+		return previousSpin[body] + delta * alpha;
+	}
+	double Time(float alpha) const { return previousTime + (time - previousTime) * alpha; }
+};
@@ -0,0 +1,109 @@
+#include <cstddef>
+
+#include "MaterialLibrary.h"
+#include "ShaderLibrary.h"
+#include "SphereRenderer.h"
+
+SphereRenderer::SphereRenderer()
+	: shader(ShaderLibrary::Get("main.vert.glsl", "main.frag.glsl")), instanceCapacity(0), drawCalls(0)
+{
+	glGenBuffers(1, &instanceVBO);
+}
+
+SphereRenderer::~SphereRenderer()
+{
+	for (auto& it : vertexArrays)
+		glDeleteVertexArrays(1, &it.second);
+	glDeleteBuffers(1, &instanceVBO);
+}
+
+void SphereRenderer::Submit(const std::shared_ptr<const Mesh>& mesh, GLuint textureArray, const glm::mat4& model, GLfloat layer)
+{
+	Batch& batch = batches[BatchKey(mesh.get(), textureArray)];
+	if (!batch.mesh)
+	{
+		batch.mesh = mesh;
+		batch.texture = textureArray;
+	}
+	SphereInstance instance = { model, layer };
+	batch.instances.push_back(instance);
+}
+
+void SphereRenderer::Flush()
+{
+	drawCalls = 0;
+
+	// Lay every batch out back to back so the whole frame is a single upload
+	staging.clear();
+	for (auto& it : batches)
+		staging.insert(staging.end(), it.second.instances.begin(), it.second.instances.end());
+	if (staging.empty())
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	if (staging.size() > instanceCapacity)
+		instanceCapacity = staging.size() * 2;
+	// Orphan the previous frame's storage so the upload does not wait on the GPU
+	glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(SphereInstance), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, staging.size() * sizeof(SphereInstance), &staging.front());
+
+	// Materials loaded since the last frame reach their texture arrays first
+	MaterialLibrary::Upload();
+
+	shader->Use();
+	glActiveTexture(GL_TEXTURE0);
+	size_t first = 0;
+	for (auto& it : batches)
+	{
+		Batch& batch = it.second;
+		if (batch.instances.empty())
+			continue;
+		glBindVertexArray(VertexArray(*batch.mesh));
+		BindInstances(first * sizeof(SphereInstance));
+		glBindTexture(GL_TEXTURE_2D_ARRAY, batch.texture);
+		glDrawElementsInstanced(GL_TRIANGLES, batch.mesh->nIndices, batch.mesh->indexType, 0, (GLsizei)batch.instances.size());
+		drawCalls++;
+		first += batch.instances.size();
+		batch.instances.clear();
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+GLuint SphereRenderer::VertexArray(const Mesh& mesh)
+{
+	auto it = vertexArrays.find(&mesh);
+	if (it != vertexArrays.end())
+		return it->second;
+
+	GLuint VAO;
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+	// Same layout as the mesh's own VAO for the per-vertex attributes
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.VB);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EB);
+	// Per-instance attributes: the model matrix takes one slot per column
+	for (GLuint i = 0; i < 5; i++)
+	{
+		glEnableVertexAttribArray(2 + i);
+		glVertexAttribDivisor(2 + i, 1);
+	}
+	vertexArrays.insert(std::make_pair(&mesh, VAO));
+	return VAO;
+}
+
+void SphereRenderer::BindInstances(size_t offset)
+{
+	// No base instance in GL 3.3, so each batch re-points the attributes at its slice
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	for (GLuint i = 0; i < 4; i++)
+		glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance),
+			(GLvoid*)(offset + offsetof(SphereInstance, model) + i * sizeof(glm::vec4)));
+	glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(SphereInstance),
+		(GLvoid*)(offset + offsetof(SphereInstance, layer)));
+}
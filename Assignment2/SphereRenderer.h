@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "MeshCache.h"
+#include "Shader.h"
+
+// Per-instance data streamed to main.vert.glsl (attributes 2-5 and 6)
+struct SphereInstance
+{
+	glm::mat4 model;
+	GLfloat layer; // texture layer of the body
+};
+
+// Collects every sphere submitted during a frame and draws each (mesh, texture array)
+// batch with a single glDrawElementsInstanced, uploading all instances at once.
+// Bodies sharing a texture array only differ by their per-instance layer.
+class SphereRenderer
+{
+public:
+	SphereRenderer();
+	~SphereRenderer();
+
+	// Queues one sphere for this frame
+	void Submit(const std::shared_ptr<const Mesh>& mesh, GLuint textureArray, const glm::mat4& model, GLfloat layer);
+	// Uploads the queued instances and draws them, then starts a new frame
+	void Flush();
+
+	// Draw calls issued by the last Flush
+	size_t DrawCalls() const { return drawCalls; }
+private:
+	typedef std::pair<const Mesh*, GLuint> BatchKey;
+	struct Batch
+	{
+		std::shared_ptr<const Mesh> mesh;
+		GLuint texture; // GL_TEXTURE_2D_ARRAY
+		std::vector<SphereInstance> instances; // keeps its capacity from frame to frame
+	};
+
+	// VAO combining a mesh's buffers with the instance buffer
+	GLuint VertexArray(const Mesh& mesh);
+	// Points the instance attributes at the given byte offset of the instance buffer
+	void BindInstances(size_t offset);
+
+	std::shared_ptr<Shader> shader;
+	GLuint instanceVBO;
+	size_t instanceCapacity; // in instances
+	std::map<BatchKey, Batch> batches;
+	std::map<const Mesh*, GLuint> vertexArrays;
+	std::vector<SphereInstance> staging;
+	size_t drawCalls;
+};
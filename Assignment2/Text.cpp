@@ -1,134 +1,532 @@
-#include "Text.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <vector>
 
-GLuint WIDTH = 800, HEIGHT = 600;
+#include "Hash.h"
+#include "MappedFile.h"
+#include "SignedDistanceField.h"
+#include "Text.h"
 
-Text::Text() : shader(Shader("text.vert.glsl", "text.frag.glsl"))
+namespace
 {
-    // Compile and setup the shader
-    glm::mat4 projection = glm::ortho(0.0f, static_cast<GLfloat>(WIDTH), 0.0f, static_cast<GLfloat>(HEIGHT));
-    shader.Use();
-    glUniformMatrix4fv(glGetUniformLocation(shader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    const char* FontPath = "arial.ttf";
+    const char* CachePath = "glyphs.cache";
 
-    // FreeType
-    FT_Library ft;
-    // All functions return a value different than 0 whenever an error occurred
-    if (FT_Init_FreeType(&ft))
-        std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+    const uint32_t CacheMagic = 0x46594c47; // "GLYF"
+    const uint32_t CacheVersion = 1;
 
-    // Load font as face
-    FT_Face face;
-    if (FT_New_Face(ft, "arial.ttf", 0, &face))
-        std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+    // The layout constants are stored so a build with different ones ignores the file
+    struct CacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t fontHash;
+        int32_t fontSize, sdfDownsample, sdfSpread;
+        int32_t pageSize, pageCount, cellSize;
+        uint32_t glyphCount;
+        uint32_t pixelBytes;
+    };
 
-    // Set size to load glyphs as
-    FT_Set_Pixel_Sizes(face, 0, 48);
+    // Followed by width * height distance texels for each glyph, in record order
+    struct CacheGlyph
+    {
+        uint32_t codePoint;
+        uint16_t width, height; // texels, 0 for glyphs without pixels
+        float bearingX, bearingY;
+        float advance;
+    };
+}
 
-    // Disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+Text::Text() : ft(NULL), face(NULL), fontOpened(false), rasterised(false), lruHead(NoCell), lruTail(NoCell), frame(0), generation(0),
+    shader(ShaderLibrary::Get("text.vert.glsl", "text.frag.glsl")), capacity(0)
+{
+    // Every cell starts free, the atlas memory is reserved once up front
+    ascii.fill(NULL);
+    cells.resize(PageCount * CellsPerPage);
+    for (int cell = (int)cells.size() - 1; cell >= 0; cell--)
+        freeCells.push_back(cell);
 
-    // Load first 128 characters of ASCII set
-    for (GLubyte c = 0; c < 128; c++)
-    {
-        // Load character glyph
-        if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-        {
-            std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-            continue;
-        }
-        // Generate texture
-        GLuint texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
-        // Set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Now store character for later use
-        Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            GLuint(face->glyph->advance.x)
-        };
-        Characters.insert(std::pair<GLchar, Character>(c, character));
-    }
-    glBindTexture(GL_TEXTURE_2D, 0);
-    // Destroy FreeType once we're finished
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, PageSize, PageSize, PageCount, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    // Set texture options
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
+    // Glyphs of previous runs come from the cache file, FreeType is only loaded on a miss
+    LoadCache();
 
-    // Configure VAO/VBO for texture quads
+    // Configure VAO/VBO for the streamed text quads, storage is allocated on the first Flush
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
+    SetupAttributes();
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
 
 Text::~Text()
 {
+    // Destroy FreeType once we're finished
+    if (face)
+        FT_Done_Face(face);
+    if (ft)
+        FT_Done_FreeType(ft);
+}
 
+void Text::Render(const std::string& text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
+{
+    // Quads are only collected here, Flush() draws everything queued this frame
+    Layout(text, x, y, scale, color, vertices);
 }
 
-void Text::Render(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
+void Text::Layout(const std::string& text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color,
+    std::vector<TextVertex>& out)
 {
-    // Activate corresponding render state
-    shader.Use();
-    glUniform3f(glGetUniformLocation(shader.Program, "textColor"), color.x, color.y, color.z);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(VAO);
+    glm::vec4 colorScale(color.x, color.y, color.z, scale);
 
-    // Iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
+    // Iterate through all code points
+    std::string::const_iterator c = text.begin();
+    while (c != text.end())
     {
-        Character ch = Characters[*c];
+        const Character* found = Find(DecodeUtf8(c, text.end()));
+        if (found == NULL)
+            continue;
+        const Character& ch = *found;
 
         GLfloat xpos = x + ch.Bearing.x * scale;
         GLfloat ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
 
         GLfloat w = ch.Size.x * scale;
         GLfloat h = ch.Size.y * scale;
-        // Update VBO for each character
-        GLfloat vertices[6][4] = {
-            { xpos,     ypos + h,   0.0, 1.0 },
-            { xpos,     ypos,       0.0, 0.0 },
-            { xpos + w, ypos,       1.0, 0.0 },
-
-            { xpos,     ypos + h,   0.0, 1.0 },
-            { xpos + w, ypos,       1.0, 0.0 },
-            { xpos + w, ypos + h,   1.0, 1.0 }
+        // Atlas rows run top-down, so the top of the quad samples UV.y
+        TextVertex quad[6] = {
+            { glm::vec4(xpos,     ypos + h,   ch.UV.x, ch.UV.y), colorScale, ch.Page },
+            { glm::vec4(xpos,     ypos,       ch.UV.x, ch.UV.w), colorScale, ch.Page },
+            { glm::vec4(xpos + w, ypos,       ch.UV.z, ch.UV.w), colorScale, ch.Page },
+
+            { glm::vec4(xpos,     ypos + h,   ch.UV.x, ch.UV.y), colorScale, ch.Page },
+            { glm::vec4(xpos + w, ypos,       ch.UV.z, ch.UV.w), colorScale, ch.Page },
+            { glm::vec4(xpos + w, ypos + h,   ch.UV.z, ch.UV.y), colorScale, ch.Page }
         };
-        // Render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-
-        // Update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // Be sure to use glBufferSubData and not glBufferData
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // Render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        // Now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-        x += (ch.Advance >> 6) * scale; // Bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
+        out.insert(out.end(), quad, quad + 6);
+        // Now advance cursors for next glyph
+        x += ch.Advance * scale;
     }
+}
+
+void Text::Flush()
+{
+    // Glyphs laid out from now on belong to the next frame
+    frame++;
+    if (vertices.empty())
+        return;
+
+    Bind();
+    glBindVertexArray(VAO);
+
+    // One upload for every string of the frame; reallocating orphans last frame's storage
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (vertices.size() > capacity)
+        capacity = vertices.size() * 2;
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(TextVertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(TextVertex), &vertices.front());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
     glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
\ No newline at end of file
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    vertices.clear();
+}
+
+void Text::Bind() const
+{
+    // Activate corresponding render state
+    shader->Use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+}
+
+void Text::SetupAttributes()
+{
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (GLvoid*)offsetof(TextVertex, vertex));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (GLvoid*)offsetof(TextVertex, colorScale));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (GLvoid*)offsetof(TextVertex, page));
+}
+
+std::vector<unsigned char> Text::DistanceField(const FT_Bitmap& bitmap, int& width, int& height)
+{
+    width = height = 0;
+    if (bitmap.width == 0 || bitmap.rows == 0)
+        return std::vector<unsigned char>();
+
+    // Leave room for the spread around the glyph and keep the size a multiple of the downsample factor
+    int pad = SdfSpread * SdfDownsample;
+    int hiWidth = ((int)bitmap.width + 2 * pad + SdfDownsample - 1) / SdfDownsample * SdfDownsample;
+    int hiHeight = ((int)bitmap.rows + 2 * pad + SdfDownsample - 1) / SdfDownsample * SdfDownsample;
+    std::vector<unsigned char> coverage((size_t)hiWidth * hiHeight, 0);
+    for (unsigned int row = 0; row < bitmap.rows; row++)
+        memcpy(&coverage[(size_t)(row + pad) * hiWidth + pad], bitmap.buffer + row * bitmap.pitch, bitmap.width);
+    std::vector<float> distance = SignedDistance(&coverage.front(), hiWidth, hiHeight);
+
+    // Average down to the atlas resolution and map [-spread, spread] to [0, 255], the edge sits at 128
+    width = hiWidth / SdfDownsample;
+    height = hiHeight / SdfDownsample;
+    std::vector<unsigned char> field((size_t)width * height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            float sum = 0.0f;
+            for (int dy = 0; dy < SdfDownsample; dy++)
+                for (int dx = 0; dx < SdfDownsample; dx++)
+                    sum += distance[(size_t)(y * SdfDownsample + dy) * hiWidth + x * SdfDownsample + dx];
+            float d = sum / (SdfDownsample * SdfDownsample) / pad;
+            field[(size_t)y * width + x] = (unsigned char)std::min(255.0f, std::max(0.0f, 128.0f + d * 127.0f));
+        }
+    return field;
+}
+
+char32_t Text::DecodeUtf8(std::string::const_iterator& it, std::string::const_iterator end)
+{
+    unsigned char lead = *it++;
+    if (lead < 0x80)
+        return lead;
+
+    int length;
+    char32_t codePoint;
+    if ((lead & 0xE0) == 0xC0) { length = 1; codePoint = lead & 0x1F; }
+    else if ((lead & 0xF0) == 0xE0) { length = 2; codePoint = lead & 0x0F; }
+    else if ((lead & 0xF8) == 0xF0) { length = 3; codePoint = lead & 0x07; }
+    else return 0xFFFD;
+
+    for (int i = 0; i < length; i++)
+    {
+        if (it == end || ((unsigned char)*it & 0xC0) != 0x80)
+            return 0xFFFD;
+        codePoint = (codePoint << 6) | ((unsigned char)*it++ & 0x3F);
+    }
+    // Overlong encodings, UTF-16 surrogates and values past Unicode would each take a cell of their own
+    static const char32_t Smallest[] = { 0x80, 0x800, 0x10000 };
+    if (codePoint < Smallest[length - 1] || (codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF)
+        return 0xFFFD;
+    return codePoint;
+}
+
+const Character* Text::Find(char32_t codePoint)
+{
+    const Glyph* glyph = codePoint < AsciiCount ? ascii[codePoint] : NULL;
+    if (glyph == NULL)
+    {
+        auto it = glyphs.find(codePoint);
+        glyph = it != glyphs.end() ? &it->second : Rasterise(codePoint);
+        if (glyph == NULL)
+            return NULL;
+    }
+    if (glyph->cell != NoCell)
+        Touch(glyph->cell);
+    return &glyph->metrics;
+}
+
+bool Text::OpenFont()
+{
+    if (fontOpened)
+        return face != NULL;
+    fontOpened = true;
+
+    // All functions return a value different than 0 whenever an error occurred
+    if (FT_Init_FreeType(&ft))
+    {
+        std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+        ft = NULL;
+        return false;
+    }
+
+    // Load font as face
+    if (FT_New_Face(ft, FontPath, 0, &face))
+    {
+        std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+        face = NULL;
+        return false;
+    }
+
+    // Set size to load glyphs as, the distance fields are built from these bitmaps
+    FT_Set_Pixel_Sizes(face, 0, FontSize);
+    return true;
+}
+
+const Text::Glyph* Text::Rasterise(char32_t codePoint)
+{
+    Glyph glyph = { Character(), NoCell, false };
+    // Glyphs that fail to load are kept with empty metrics so they are not retried every frame,
+    // but they are not saved: the next run tries them again
+    if (!OpenFont() || FT_Load_Char(face, codePoint, FT_LOAD_RENDER))
+    {
+        glyph.failed = true;
+        if (face)
+            std::cout << "ERROR::FREETYTPE: Failed to load Glyph " << (unsigned)codePoint << std::endl;
+    }
+    else
+    {
+        int w, h;
+        std::vector<unsigned char> field = DistanceField(face->glyph->bitmap, w, h);
+        if (w > 0)
+        {
+            int cell = AllocateCell();
+            if (cell == NoCell)
+                return NULL;
+
+            // Clear the whole cell so nothing of an evicted glyph bleeds into this one,
+            // fields larger than a cell lose their outermost distance texels
+            int stride = w;
+            if (w > CellSize)
+                w = CellSize;
+            if (h > CellSize)
+                h = CellSize;
+            std::vector<unsigned char> pixels(CellSize * CellSize, 0);
+            for (int row = 0; row < h; row++)
+                memcpy(&pixels[row * CellSize], &field[row * stride], w);
+            Place(glyph, codePoint, cell, w, h);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, cell % CellsPerPage % CellsPerRow * CellSize,
+                cell % CellsPerPage / CellsPerRow * CellSize, cell / CellsPerPage, CellSize, CellSize, 1,
+                GL_RED, GL_UNSIGNED_BYTE, &pixels.front());
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        }
+
+        // Metrics stay in FontSize pixels, the quad grows by the spread kept around the glyph
+        GLfloat spread = (GLfloat)(w > 0 ? SdfSpread * SdfDownsample : 0);
+        glyph.metrics.Size = glm::vec2(w * SdfDownsample, h * SdfDownsample);
+        glyph.metrics.Bearing = glm::vec2(face->glyph->bitmap_left - spread, face->glyph->bitmap_top + spread);
+        glyph.metrics.Advance = face->glyph->advance.x / 64.0f;
+    }
+
+    rasterised = true;
+    return Store(codePoint, glyph);
+}
+
+void Text::Place(Glyph& glyph, char32_t codePoint, int cell, int w, int h)
+{
+    int page = cell / CellsPerPage;
+    int cellX = cell % CellsPerPage % CellsPerRow * CellSize;
+    int cellY = cell % CellsPerPage / CellsPerRow * CellSize;
+    glyph.cell = cell;
+    glyph.metrics.UV = glm::vec4((GLfloat)cellX / PageSize, (GLfloat)cellY / PageSize,
+        (GLfloat)(cellX + w) / PageSize, (GLfloat)(cellY + h) / PageSize);
+    glyph.metrics.Page = (GLfloat)page;
+    cells[cell].codePoint = codePoint;
+}
+
+const Text::Glyph* Text::Store(char32_t codePoint, const Glyph& glyph)
+{
+    // unordered_map nodes never move, so the ASCII table can point straight at them
+    const Glyph* stored = &(glyphs[codePoint] = glyph);
+    if (codePoint < AsciiCount)
+        ascii[codePoint] = stored;
+    return stored;
+}
+
+bool Text::FontHash(uint64_t& hash)
+{
+    MappedFile font;
+    if (!font.Open(FontPath))
+        return false;
+    hash = Fnv1a(Fnv1aOffset, font.Data(), font.Size());
+    return true;
+}
+
+void Text::LoadCache()
+{
+    MappedFile cache;
+    if (!cache.Open(CachePath) || cache.Size() < sizeof(CacheHeader))
+        return;
+
+    CacheHeader header;
+    memcpy(&header, cache.Data(), sizeof(header));
+    uint64_t fontHash;
+    if (header.magic != CacheMagic || header.version != CacheVersion
+        || header.fontSize != FontSize || header.sdfDownsample != SdfDownsample || header.sdfSpread != SdfSpread
+        || header.pageSize != PageSize || header.pageCount != PageCount || header.cellSize != CellSize
+        || header.glyphCount > (cache.Size() - sizeof(header)) / sizeof(CacheGlyph)
+        || cache.Size() != sizeof(header) + header.glyphCount * sizeof(CacheGlyph) + header.pixelBytes
+        || !FontHash(fontHash) || fontHash != header.fontHash)
+        return;
+
+    // Records are stored least recently used first, so allocating in file order restores the LRU order.
+    // The cells are composed into whole pages here and uploaded with one call.
+    const unsigned char* records = cache.Data() + sizeof(header);
+    const unsigned char* texels = records + header.glyphCount * sizeof(CacheGlyph);
+    const unsigned char* texelsEnd = texels + header.pixelBytes;
+    std::vector<unsigned char> pages((size_t)PageSize * PageSize * PageCount, 0);
+    int usedPages = 0;
+    for (uint32_t i = 0; i < header.glyphCount; i++)
+    {
+        CacheGlyph record;
+        memcpy(&record, records + i * sizeof(CacheGlyph), sizeof(record));
+        size_t bytes = (size_t)record.width * record.height;
+        if (record.width > CellSize || record.height > CellSize || (size_t)(texelsEnd - texels) < bytes)
+            break;
+
+        Glyph glyph = { Character(), NoCell, false };
+        if (bytes > 0)
+        {
+            int cell = AllocateCell();
+            if (cell == NoCell)
+                break;
+            Place(glyph, record.codePoint, cell, record.width, record.height);
+            int page = cell / CellsPerPage;
+            int cellX = cell % CellsPerPage % CellsPerRow * CellSize;
+            int cellY = cell % CellsPerPage / CellsPerRow * CellSize;
+            unsigned char* dst = &pages[((size_t)page * PageSize + cellY) * PageSize + cellX];
+            for (int row = 0; row < record.height; row++)
+                memcpy(dst + (size_t)row * PageSize, texels + row * record.width, record.width);
+            texels += bytes;
+            usedPages = std::max(usedPages, page + 1);
+        }
+        glyph.metrics.Size = glm::vec2(record.width * SdfDownsample, record.height * SdfDownsample);
+        glyph.metrics.Bearing = glm::vec2(record.bearingX, record.bearingY);
+        glyph.metrics.Advance = record.advance;
+        Store(record.codePoint, glyph);
+    }
+
+    if (usedPages > 0)
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, PageSize, PageSize, usedPages,
+            GL_RED, GL_UNSIGNED_BYTE, &pages.front());
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+}
+
+void Text::SaveCache() const
+{
+    uint64_t fontHash;
+    if (!rasterised || !FontHash(fontHash))
+        return;
+
+    // Glyphs without pixels first, then the cells from least to most recently used
+    std::vector<CacheGlyph> records;
+    for (auto& entry : glyphs)
+    {
+        if (entry.second.cell != NoCell || entry.second.failed)
+            continue;
+        const Character& ch = entry.second.metrics;
+        CacheGlyph record = { (uint32_t)entry.first, 0, 0, ch.Bearing.x, ch.Bearing.y, ch.Advance };
+        records.push_back(record);
+    }
+    size_t firstCellRecord = records.size();
+    std::vector<int> recordCells;
+    uint32_t pixelBytes = 0;
+    for (int cell = lruTail; cell != NoCell; cell = cells[cell].prev)
+    {
+        const Character& ch = glyphs.at(cells[cell].codePoint).metrics;
+        CacheGlyph record = { (uint32_t)cells[cell].codePoint,
+            (uint16_t)(ch.Size.x / SdfDownsample), (uint16_t)(ch.Size.y / SdfDownsample),
+            ch.Bearing.x, ch.Bearing.y, ch.Advance };
+        records.push_back(record);
+        recordCells.push_back(cell);
+        pixelBytes += record.width * record.height;
+    }
+
+    // Only the cell corners holding glyphs are kept
+    std::vector<unsigned char> pages((size_t)PageSize * PageSize * PageCount);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+    glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RED, GL_UNSIGNED_BYTE, &pages.front());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    std::vector<unsigned char> texels;
+    texels.reserve(pixelBytes);
+    for (size_t i = firstCellRecord; i < records.size(); i++)
+    {
+        int cell = recordCells[i - firstCellRecord];
+        int page = cell / CellsPerPage;
+        int cellX = cell % CellsPerPage % CellsPerRow * CellSize;
+        int cellY = cell % CellsPerPage / CellsPerRow * CellSize;
+        const unsigned char* src = &pages[((size_t)page * PageSize + cellY) * PageSize + cellX];
+        for (int row = 0; row < records[i].height; row++)
+            texels.insert(texels.end(), src + (size_t)row * PageSize, src + (size_t)row * PageSize + records[i].width);
+    }
+
+    CacheHeader header = { CacheMagic, CacheVersion, fontHash, FontSize, SdfDownsample, SdfSpread,
+        PageSize, PageCount, CellSize, (uint32_t)records.size(), pixelBytes };
+    std::ofstream file(CachePath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR::TEXT::CACHE::WRITE_FAILED " << CachePath << std::endl;
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!records.empty())
+        file.write(reinterpret_cast<const char*>(&records.front()), records.size() * sizeof(CacheGlyph));
+    if (!texels.empty())
+        file.write(reinterpret_cast<const char*>(&texels.front()), texels.size());
+}
+
+int Text::AllocateCell()
+{
+    if (!freeCells.empty())
+    {
+        int cell = freeCells.back();
+        freeCells.pop_back();
+        PushFront(cell);
+        return cell;
+    }
+
+    // Evict the least recently used glyph, unless even that one is on screen this frame
+    int cell = lruTail;
+    if (cell == NoCell || cells[cell].lastUsed == frame)
+        return NoCell;
+    char32_t evicted = cells[cell].codePoint;
+    glyphs.erase(evicted);
+    if (evicted < AsciiCount)
+        ascii[evicted] = NULL;
+    generation++;
+    Touch(cell);
+    return cell;
+}
+
+void Text::Touch(int cell)
+{
+    cells[cell].lastUsed = frame;
+    if (lruHead == cell)
+        return;
+    Unlink(cell);
+    PushFront(cell);
+}
+
+void Text::Unlink(int cell)
+{
+    Cell& c = cells[cell];
+    if (c.prev != NoCell)
+        cells[c.prev].next = c.next;
+    else
+        lruHead = c.next;
+    if (c.next != NoCell)
+        cells[c.next].prev = c.prev;
+    else
+        lruTail = c.prev;
+    c.prev = c.next = NoCell;
+}
+
+void Text::PushFront(int cell)
+{
+    Cell& c = cells[cell];
+    c.lastUsed = frame;
+    c.prev = NoCell;
+    c.next = lruHead;
+    if (lruHead != NoCell)
+        cells[lruHead].prev = cell;
+    lruHead = cell;
+    if (lruTail == NoCell)
+        lruTail = cell;
+}
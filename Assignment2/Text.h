@@ -8,16 +8,27 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
-#include <map>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 
-#include "shader.h"
+#include "ShaderLibrary.h"
 
 /// Holds all state information relevant to a character as loaded using FreeType
 struct Character {
-    GLuint TextureID;   // ID handle of the glyph texture
-    glm::ivec2 Size;    // Size of glyph
-    glm::ivec2 Bearing;  // Offset from baseline to left/top of glyph
-    GLuint Advance;    // Horizontal offset to advance to next glyph
+    glm::vec4 UV;       // Glyph rectangle in its atlas page (u0, v0, u1, v1), v0 is the top row
+    GLfloat Page;       // Atlas page (texture array layer) holding the glyph
+    glm::vec2 Size;     // Size of glyph quad, in FontSize pixels
+    glm::vec2 Bearing;  // Offset from baseline to left/top of glyph quad
+    GLfloat Advance;    // Horizontal offset to advance to next glyph
+};
+
+/// One corner of a glyph quad, as streamed to text.vert.glsl
+struct TextVertex {
+    glm::vec4 vertex;     // <vec2 pos, vec2 tex>
+    glm::vec4 colorScale; // <vec3 color, float scale> of the string
+    GLfloat page;         // atlas page of the glyph
 };
 
 class Text
@@ -26,11 +37,90 @@ public:
 	Text();
 	~Text();
 
-	void Render(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color);
+	// Queues a UTF-8 string, nothing is drawn until Flush()
+	void Render(const std::string& text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color);
+	// Draws every string queued since the last flush with a single draw call
+	void Flush();
+
+	// Appends the quads of a UTF-8 string to out, in screen pixels.
+	// Glyphs are rasterised on first use and may evict least recently used ones.
+	void Layout(const std::string& text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color,
+		std::vector<TextVertex>& out);
+	// Changes whenever a glyph is evicted, quads laid out before then may be stale
+	unsigned Generation() const { return generation; }
+	// Writes the resident glyphs to the glyph cache file if any were rasterised this run,
+	// the next start maps it instead of loading FreeType. Needs the GL context.
+	void SaveCache() const;
+	// Activates the text program and glyph atlas
+	void Bind() const;
+	// Sets the TextVertex attribute layout on the bound VAO and VBO
+	static void SetupAttributes();
     
 private:
-    std::map<GLchar, Character> Characters;
+    // Glyphs are rasterised at FontSize, turned into distance fields and stored at
+    // 1/SdfDownsample of that size with SdfSpread atlas texels of distance around them
+    static const int FontSize = 48;
+    static const int SdfDownsample = 2;
+    static const int SdfSpread = 3;
+    // The atlas is a fixed budget of PageCount pages split into square cells, one glyph per cell
+    static const int PageSize = 512;
+    static const int PageCount = 4;
+    static const int CellSize = 32;
+    static const int CellsPerRow = PageSize / CellSize;
+    static const int CellsPerPage = CellsPerRow * CellsPerRow;
+    static const int NoCell = -1;
+    static const GLuint AsciiCount = 128;
+
+    struct Glyph {
+        Character metrics;
+        int cell;           // NoCell for glyphs without pixels, such as spaces
+        bool failed;        // could not be rasterised, kept for this run only
+    };
+    struct Cell {
+        char32_t codePoint; // glyph stored in the cell
+        unsigned lastUsed;  // frame the glyph was last laid out in
+        int prev, next;     // least recently used list, most recent first
+    };
+
+    // Builds the atlas-resolution distance field of a glyph bitmap
+    static std::vector<unsigned char> DistanceField(const FT_Bitmap& bitmap, int& width, int& height);
+    // Reads one code point, invalid sequences decode to U+FFFD
+    static char32_t DecodeUtf8(std::string::const_iterator& it, std::string::const_iterator end);
+
+    // Hash of the font file the cache was built from, false if the font is missing
+    static bool FontHash(uint64_t& hash);
+
+    // Maps the glyph cache file and uploads its glyphs, does nothing if it is missing or stale
+    void LoadCache();
+    // Loads FreeType and the font on the first glyph the cache did not hold
+    bool OpenFont();
+    // Metrics of a glyph, rasterising it if needed. Null when the atlas is full of glyphs used this frame.
+    const Character* Find(char32_t codePoint);
+    const Glyph* Rasterise(char32_t codePoint);
+    // Points a glyph at a w x h texel rectangle in the corner of a cell
+    void Place(Glyph& glyph, char32_t codePoint, int cell, int w, int h);
+    const Glyph* Store(char32_t codePoint, const Glyph& glyph);
+    // A free cell, or the least recently used one once the budget is reached
+    int AllocateCell();
+    void Touch(int cell);
+    void Unlink(int cell);
+    void PushFront(int cell);
+
+    FT_Library ft;
+    FT_Face face;
+    bool fontOpened;                                // FreeType was tried, even if it failed
+    bool rasterised;                                // glyphs were added since the cache was loaded
+    GLuint atlas;                                   // GL_TEXTURE_2D_ARRAY of PageCount pages
+    std::unordered_map<char32_t, Glyph> glyphs;     // every resident glyph
+    std::array<const Glyph*, AsciiCount> ascii;     // fast path into glyphs, null until rasterised
+    std::vector<Cell> cells;
+    std::vector<int> freeCells;
+    int lruHead, lruTail;
+    unsigned frame;
+    unsigned generation;
+
     GLuint VAO, VBO;
-    Shader shader;
+    std::shared_ptr<Shader> shader;
+    std::vector<TextVertex> vertices; // quads of the current frame
+    size_t capacity;                  // VBO size in vertices
 };
-
@@ -0,0 +1,154 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "JobSystem.h"
+
+const int TransformHierarchy::NoParent;
+
+namespace
+{
+	// Nodes per job, smaller levels are updated inline
+	const size_t LevelGrain = 4096;
+}
+
+int TransformHierarchy::Add(int parentNode)
+{
+	int node = (int)index.size();
+	index.push_back((int)parent.size());
+	parentHandle.push_back(NoParent);
+	handle.push_back(node);
+	parent.push_back(NoParent);
+	local.push_back(glm::mat4(1.0f));
+	world.push_back(glm::mat4(1.0f));
+	dirty.push_back(1);
+	unsorted = true;
+	if (parentNode != NoParent)
+		SetParent(node, parentNode);
+	return node;
+}
+
+int TransformHierarchy::AddRange(const int32_t* parents, size_t count)
+{
+	// New nodes are appended, at the positions following the existing ones
+	int first = (int)index.size();
+	int position = (int)parent.size();
+	size_t total = index.size() + count;
+	index.reserve(total);
+	parentHandle.reserve(total);
+	handle.reserve(total);
+	for (size_t i = 0; i < count; i++)
+	{
+		int node = first + (int)i;
+		index.push_back(position + (int)i);
+		parentHandle.push_back(parents[i] < 0 || parents[i] >= (int32_t)i ? NoParent : first + parents[i]);
+		handle.push_back(node);
+	}
+	parent.resize(parent.size() + count, NoParent);
+	local.resize(parent.size(), glm::mat4(1.0f));
+	world.resize(parent.size(), glm::mat4(1.0f));
+	dirty.resize(parent.size(), 1);
+	unsorted = true;
+	return first;
+}
+
+void TransformHierarchy::SetParent(int node, int parentNode)
+{
+	// Refuse cycles, the node would never be reached by the sort
+	for (int ancestor = parentNode; ancestor != NoParent; ancestor = parentHandle[ancestor])
+	{
+		if (ancestor == node)
+		{
+			std::cout << "ERROR::TRANSFORM::CYCLE node " << node << " cannot be parented to " << parentNode << std::endl;
+			return;
+		}
+	}
+	parentHandle[node] = parentNode;
+	dirty[index[node]] = 1;
+	// Depths change with the parent, the next Update re-sorts and regroups the levels
+	unsorted = true;
+}
+
+void TransformHierarchy::SetLocal(int node, const glm::mat4& transform)
+{
+	int i = index[node];
+	local[i] = transform;
+	dirty[i] = 1;
+}
+
+void TransformHierarchy::Sort()
+{
+	// Breadth first from the roots: each depth level only depends on the previous ones
+	size_t count = handle.size();
+	std::vector<std::vector<int>> children(count);
+	std::vector<int> order;
+	order.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		int node = handle[i];
+		if (parentHandle[node] == NoParent)
+			order.push_back(node);
+		else
+			children[parentHandle[node]].push_back(node);
+	}
+	for (size_t next = 0; next < order.size(); next++)
+		order.insert(order.end(), children[order[next]].begin(), children[order[next]].end());
+
+	std::vector<glm::mat4> sortedLocal(count), sortedWorld(count);
+	std::vector<unsigned char> sortedDirty(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		int from = index[order[i]];
+		sortedLocal[i] = local[from];
+		sortedWorld[i] = world[from];
+		sortedDirty[i] = dirty[from];
+	}
+	for (size_t i = 0; i < count; i++)
+		index[order[i]] = (int)i;
+	for (size_t i = 0; i < count; i++)
+	{
+		int node = order[i];
+		parent[i] = parentHandle[node] == NoParent ? NoParent : index[parentHandle[node]];
+	}
+	// Breadth first order never goes back to a smaller depth
+	std::vector<int> depth(count);
+	levels.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		depth[i] = parent[i] == NoParent ? 0 : depth[parent[i]] + 1;
+		if (i == 0 || depth[i] != depth[i - 1])
+			levels.push_back(i);
+	}
+	levels.push_back(count);
+	handle.swap(order);
+	local.swap(sortedLocal);
+	world.swap(sortedWorld);
+	dirty.swap(sortedDirty);
+	unsorted = false;
+}
+
+void TransformHierarchy::Update()
+{
+	if (unsorted)
+		Sort();
+
+	// Parents are in earlier levels, so their dirty flag and world matrix are final by the
+	// time a level is reached, and the nodes within it are independent of each other
+	for (size_t l = 0; l + 1 < levels.size(); l++)
+	{
+		size_t first = levels[l];
+		JobSystem::ParallelFor(levels[l + 1] - first, LevelGrain, [&](size_t begin, size_t end) {
+			for (size_t i = first + begin; i < first + end; i++)
+			{
+				int p = parent[i];
+				if (p != NoParent && dirty[p])
+					dirty[i] = 1;
+				if (!dirty[i])
+					continue;
+				world[i] = p == NoParent ? local[i] : world[p] * local[i];
+			}
+		});
+	}
+	std::fill(dirty.begin(), dirty.end(), 0);
+}
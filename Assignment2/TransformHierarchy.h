@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Parent/child transforms kept in flat arrays sorted breadth first, so every parent precedes
+// its children and each depth level is contiguous. Update() walks the levels in order, the
+// nodes of a level in parallel, and only recomputes the world matrices of nodes whose local
+// transform, or an ancestor's, changed since the last update.
+// Nodes are referred to by the handle Add() returns, which survives re-sorting.
+class TransformHierarchy
+{
+public:
+	static const int NoParent = -1;
+
+	TransformHierarchy() : unsorted(false) {}
+
+	// Adds a node with an identity local transform. The parent may be added later and set with SetParent.
+	int Add(int parent = NoParent);
+	// Adds count nodes at once, returns the first handle. parents[i] is the index of node i's parent
+	// within the range, or NoParent; it must be below i so the range cannot contain cycles.
+	int AddRange(const int32_t* parents, size_t count);
+	void SetParent(int node, int parent);
+	void SetLocal(int node, const glm::mat4& local);
+
+	int Parent(int node) const { return parentHandle[node]; }
+	const glm::mat4& Local(int node) const { return local[index[node]]; }
+	// World transform as of the last Update()
+	const glm::mat4& World(int node) const { return world[index[node]]; }
+	glm::vec3 WorldPosition(int node) const { return glm::vec3(World(node)[3]); }
+
+	// Re-sorts after a structural change, then propagates dirty transforms down the hierarchy
+	void Update();
+	size_t Size() const { return parent.size(); }
+private:
+	// Reorders the arrays parents first, keeping the relative order of siblings
+	void Sort();
+
+	// Indexed by sorted position
+	std::vector<int> parent;     // sorted position of the parent, or NoParent
+	std::vector<glm::mat4> local;
+	std::vector<glm::mat4> world;
+	std::vector<unsigned char> dirty;
+	std::vector<int> handle;     // handle of the node at each position
+	std::vector<size_t> levels;  // first position of each depth, then the node count
+	// Indexed by handle
+	std::vector<int> index;      // sorted position of each handle
+	std::vector<int> parentHandle;
+	bool unsorted;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+
+// Hands the newest complete value from one writer thread to one reader thread without locks
+// or waiting. The writer fills Back() and publishes it; the reader takes the newest published
+// value when it wants one. Values skipped by a slower reader are simply overwritten.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : middle(1), front(0), back(2) {}
+
+	// Writer side: the value to fill, left as it was three publishes ago
+	T& Back() { return buffers[back]; }
+	// Writer side: makes Back() the newest value and hands out another buffer to fill
+	void Publish() { back = middle.exchange(back | Fresh) & Index; }
+
+	// Reader side: moves to the newest published value, false when nothing was published since
+	bool Acquire()
+	{
+		if (!(middle.load() & Fresh))
+			return false;
+		front = middle.exchange(front) & Index;
+		return true;
+	}
+	// Reader side: the value taken by the last Acquire, untouched by the writer until the next one
+	const T& Front() const { return buffers[front]; }
+private:
+	static const int Index = 3;
+	static const int Fresh = 4; // set while the middle buffer has not been read
+
+	T buffers[3];
+	std::atomic<int> middle;    // buffer between the two threads, plus the Fresh bit
+	int front, back;            // owned by the reader and the writer respectively
+};
@@ -0,0 +1,87 @@
+#include "UiLayer.h"
+
+TextBlock::TextBlock() : visible(true), count(0), generation(0), dirty(true)
+{
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	Text::SetupAttributes();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+TextBlock::~TextBlock()
+{
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+}
+
+void TextBlock::SetLine(size_t index, const std::string& text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
+{
+	if (index >= lines.size())
+		lines.resize(index + 1);
+	Line& line = lines[index];
+	if (line.text == text && line.x == x && line.y == y && line.scale == scale
+		&& line.color.x == color.x && line.color.y == color.y && line.color.z == color.z)
+		return;
+	line.text = text;
+	line.x = x;
+	line.y = y;
+	line.scale = scale;
+	line.color = color;
+	dirty = true;
+}
+
+void TextBlock::Draw(Text& text)
+{
+	if (dirty || generation != text.Generation())
+	{
+		std::vector<TextVertex> vertices;
+		for (const Line& line : lines)
+			text.Layout(line.text, line.x, line.y, line.scale, line.color, vertices);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(TextVertex),
+			vertices.empty() ? NULL : &vertices.front(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		count = (GLsizei)vertices.size();
+		generation = text.Generation();
+		dirty = false;
+	}
+	if (count == 0)
+		return;
+
+	glBindVertexArray(VAO);
+	glDrawArrays(GL_TRIANGLES, 0, count);
+	glBindVertexArray(0);
+}
+
+TextBlock& UiLayer::AddBlock()
+{
+	blocks.push_back(std::unique_ptr<TextBlock>(new TextBlock()));
+	return *blocks.back();
+}
+
+void UiLayer::Resize()
+{
+	for (auto& block : blocks)
+		block->Invalidate();
+}
+
+void UiLayer::Draw(Text& text)
+{
+	bool bound = false;
+	for (auto& block : blocks)
+	{
+		if (!block->visible)
+			continue;
+		if (!bound)
+		{
+			text.Bind();
+			bound = true;
+		}
+		block->Draw(text);
+	}
+	if (bound)
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Text.h"
+
+// A group of text lines laid out once into its own vertex buffer.
+// The buffer is only rebuilt when a line changes, the layer is resized
+// or the glyph cache evicted a glyph the block may be using.
+class TextBlock
+{
+public:
+	TextBlock();
+	~TextBlock();
+
+	// Sets a line of the block, does nothing if it is unchanged
+	void SetLine(size_t index, const std::string& text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color);
+	// Forces a rebuild on the next draw
+	void Invalidate() { dirty = true; }
+	// Draws the cached quads, rebuilding them first if needed
+	void Draw(Text& text);
+
+	bool visible;
+private:
+	struct Line
+	{
+		std::string text;
+		GLfloat x, y, scale;
+		glm::vec3 color;
+	};
+
+	std::vector<Line> lines;
+	GLuint VAO, VBO;
+	GLsizei count;
+	unsigned generation; // glyph cache generation the quads were laid out with
+	bool dirty;
+};
+
+// Retained-mode overlay: static text blocks drawn from cached buffers every frame
+class UiLayer
+{
+public:
+	// Creates a block owned by the layer
+	TextBlock& AddBlock();
+	// Rebuilds every block on its next draw, call when the window size changes
+	void Resize();
+	// Draws the visible blocks
+	void Draw(Text& text);
+private:
+	std::vector<std::unique_ptr<TextBlock>> blocks;
+};
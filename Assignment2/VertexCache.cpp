@@ -0,0 +1,112 @@
+#include "VertexCache.h"
+
+namespace
+{
+	// Next vertex to fan around: the candidate that stays longest in the cache, or a dead-end fallback
+	int NextVertex(const std::vector<unsigned>& candidates, const std::vector<int>& live, const std::vector<int>& timeStamp,
+		int time, unsigned cacheSize, std::vector<unsigned>& deadEnd, unsigned& cursor)
+	{
+		int best = -1;
+		int bestPriority = -1;
+		for (unsigned v : candidates)
+		{
+			if (live[v] <= 0)
+				continue;
+			// Vertices that will still be cached after emitting their remaining triangles are preferred
+			int priority = 0;
+			if (time - timeStamp[v] + 2 * live[v] <= (int)cacheSize)
+				priority = time - timeStamp[v];
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				best = v;
+			}
+		}
+		if (best != -1)
+			return best;
+
+		// Dead end: go back to recently emitted vertices, then scan the rest of the mesh
+		while (!deadEnd.empty())
+		{
+			unsigned v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0)
+				return v;
+		}
+		while (cursor < live.size())
+		{
+			if (live[cursor] > 0)
+				return cursor;
+			cursor++;
+		}
+		return -1;
+	}
+}
+
+std::vector<unsigned> Tipsify(const std::vector<unsigned>& indices, unsigned vertexCount, unsigned cacheSize)
+{
+	size_t triangleCount = indices.size() / 3;
+
+	// Vertex -> triangle adjacency in compressed rows
+	std::vector<int> live(vertexCount, 0);
+	for (unsigned index : indices)
+		live[index]++;
+	std::vector<unsigned> offsets(vertexCount + 1, 0);
+	for (unsigned v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + live[v];
+	std::vector<unsigned> adjacency(indices.size());
+	std::vector<unsigned> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = (unsigned)t;
+
+	std::vector<int> timeStamp(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned> deadEnd;
+	std::vector<unsigned> candidates;
+	std::vector<unsigned> output;
+	output.reserve(indices.size());
+
+	int time = cacheSize + 1;
+	unsigned cursor = 0;
+	int fan = vertexCount > 0 ? 0 : -1;
+	while (fan >= 0)
+	{
+		candidates.clear();
+		for (unsigned a = offsets[fan]; a < offsets[fan + 1]; a++)
+		{
+			unsigned t = adjacency[a];
+			if (emitted[t])
+				continue;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned v = indices[t * 3 + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				// Not in the cache any more: this emission loads it again
+				if (time - timeStamp[v] > (int)cacheSize)
+					timeStamp[v] = time++;
+			}
+			emitted[t] = true;
+		}
+		fan = NextVertex(candidates, live, timeStamp, time, cacheSize, deadEnd, cursor);
+	}
+	return output;
+}
+
+float AverageCacheMissRatio(const std::vector<unsigned>& indices, unsigned vertexCount, unsigned cacheSize)
+{
+	if (indices.size() < 3)
+		return 0.0f;
+	// FIFO cache simulated with load timestamps
+	std::vector<int> timeStamp(vertexCount, -(int)cacheSize - 1);
+	int misses = 0;
+	for (unsigned v : indices)
+	{
+		if (misses - timeStamp[v] > (int)cacheSize)
+			timeStamp[v] = misses++;
+	}
+	return (float)misses / (indices.size() / 3);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Post-transform vertex cache helpers for indexed triangle lists
+
+// Reorders triangles with Tipsify (Sander, Nehab & Barczak 2007) for a FIFO cache of cacheSize entries
+std::vector<unsigned> Tipsify(const std::vector<unsigned>& indices, unsigned vertexCount, unsigned cacheSize = 16);
+
+// Average cache miss ratio: vertex shader invocations per triangle with a FIFO cache of cacheSize entries
+float AverageCacheMissRatio(const std::vector<unsigned>& indices, unsigned vertexCount, unsigned cacheSize = 16);
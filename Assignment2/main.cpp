@@ -17,16 +17,43 @@
 #include <string>
 
 #include <cmath>
+#include <cstdio>
 
 // Other includes
-#include "Shader.h"
-#include "Sphere.h"
+#include "Benchmark.h"
+#include "BodyStorage.h"
+#include "BodySystems.h"
+#include "CameraBuffer.h"
+#include "JobSystem.h"
+#include "MaterialLibrary.h"
+#include "MeshCache.h"
+#include "ParticleSystem.h"
+#include "SceneFile.h"
+#include "ShaderLibrary.h"
+#include "Simulation.h"
+#include "SphereRenderer.h"
 #include "Text.h"
+#include "TransformHierarchy.h"
+#include "UiLayer.h"
+
+GLuint WIDTH = 800, HEIGHT = 600;
+bool windowResized = false;
 
 bool displayNames = true;
 bool displayHelp = true;
-float speedScale = 1.0f;
+// Receives the keys that change the simulation, they are applied at its next tick
+Simulation* simulation = nullptr;
+
+// One orbit of the Earth, in simulated seconds
+const double SimulatedYear = 6.0;
 
+// Help overlay lines, stacked from line 0 at the top down to the bottom of the window
+const int HelpLineCount = 8;
+const float HelpLineSpacing = 25.0f;
+float HelpLineY(int line)
+{
+	return 10.0f + (HelpLineCount - 1 - line) * HelpLineSpacing;
+}
 // Is called whenever a key is pressed/released via GLFW
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode)
 {
@@ -36,19 +63,55 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 		displayHelp = !displayHelp;
 	if (key == GLFW_KEY_N && action == GLFW_PRESS)
 		displayNames = !displayNames;
-	if (key == GLFW_KEY_RIGHT && action == GLFW_PRESS && speedScale < 2.0)
-		speedScale += 0.1;
-	if (key == GLFW_KEY_LEFT && action == GLFW_PRESS && speedScale > 0.0)
-		speedScale -= 0.1;
+	if (simulation == nullptr || action != GLFW_PRESS)
+		return;
+	// Simulated time runs time warp * speed scale faster than real time
+	if (key == GLFW_KEY_RIGHT)
+		simulation->Post(SimulationCommand::ChangeSpeed, 0.1);
+	if (key == GLFW_KEY_LEFT)
+		simulation->Post(SimulationCommand::ChangeSpeed, -0.1);
+	if (key == GLFW_KEY_UP)
+		simulation->Post(SimulationCommand::ChangeWarp, 10.0);
+	if (key == GLFW_KEY_DOWN)
+		simulation->Post(SimulationCommand::ChangeWarp, 0.1);
+	if (key == GLFW_KEY_PAGE_UP)
+		simulation->Post(SimulationCommand::Jump, 1000.0);
+	if (key == GLFW_KEY_PAGE_DOWN)
+		simulation->Post(SimulationCommand::Jump, -1000.0);
+	if (key == GLFW_KEY_HOME)
+		simulation->Post(SimulationCommand::Reset);
+	if (key == GLFW_KEY_G)
+		simulation->Post(SimulationCommand::ToggleGravity);
+	if (key == GLFW_KEY_F5)
+		simulation->Post(SimulationCommand::SaveCheckpoint);
+	if (key == GLFW_KEY_F9)
+		simulation->Post(SimulationCommand::RestoreCheckpoint);
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	glViewport(0, 0, width, height);
+	// Minimised windows report 0x0, keep the last usable size
+	if (width > 0 && height > 0)
+	{
+		WIDTH = width;
+		HEIGHT = height;
+		windowResized = true;
+	}
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	// Kernel measurements or checks only, without opening a window
+	if (argc > 1 && (std::string(argv[1]) == "--bench" || std::string(argv[1]) == "--check"))
+	{
+		int result = std::string(argv[1]) == "--bench" ? RunBenchmarks(std::cout) : RunChecks(std::cout);
+		JobSystem::Shutdown();
+		return result;
+	}
+	// Text (.scene) or compiled scene to show
+	std::string scenePath = argc > 1 ? argv[1] : "solar.scene";
+
 	glfwInit();
 
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -56,12 +119,14 @@ int main()
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	// Create window
-	GLFWwindow* window = glfwCreateWindow(800, 600, "Assignment2", nullptr, nullptr);
+	GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Assignment2", nullptr, nullptr);
 	glfwMakeContextCurrent(window);
 
 	// Set the required callback functions
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetKeyCallback(window, key_callback);
+	// Rendering is capped to the display refresh, the simulation no longer depends on it
+	glfwSwapInterval(1);
 
 	// Initialize GLAD to setup the OpenGL Function pointers
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -74,74 +139,135 @@ int main()
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// Particles size their sprites from their distance
+	glEnable(GL_PROGRAM_POINT_SIZE);
 
 	std::unique_ptr<glm::mat4> view = nullptr;
 	std::unique_ptr<glm::mat4> projection = nullptr;
 
 	view = std::make_unique<glm::mat4>(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -50.0f)));
 	projection = std::make_unique<glm::mat4>(
-		glm::perspective(glm::radians(45.0f), (GLfloat)800.0 / (GLfloat)600.0, 0.1f, 1000.0f));
+		glm::perspective(glm::radians(45.0f), (GLfloat)WIDTH / (GLfloat)HEIGHT, 0.1f, 1000.0f));
+	glm::mat4 screen = glm::ortho(0.0f, static_cast<GLfloat>(WIDTH), 0.0f, static_cast<GLfloat>(HEIGHT));
+
+	// View and projection are shared by every program through one uniform buffer
+	std::unique_ptr<CameraBuffer> camera = std::make_unique<CameraBuffer>();
+	// All bodies are drawn with one instanced call per (mesh, texture) batch
+	std::unique_ptr<SphereRenderer> renderer = std::make_unique<SphereRenderer>();
 
 	// Init text display class
 	Text text;
 
-	const float distance = 3.0f;
-
-	// Create planets
-	std::shared_ptr<Sphere> sun = std::make_shared<Sphere>(2, 36, 18, nullptr, 0, 0, 0, "Sun", true, "textures/sun.jpg");
-	std::shared_ptr<Sphere> mercury = std::make_shared<Sphere>(.2, 36, 18, sun, 1 * distance, 0.0f, 4.0f, "Mercury", true, "textures/mercury.jpg");
-	std::shared_ptr<Sphere> venus = std::make_shared<Sphere>(.3, 36, 18, sun, 2 * distance, 0.0f, 1.8f, "Venus", false, "textures/venus.jpg");
-	std::shared_ptr<Sphere> earth = std::make_shared<Sphere>(.5, 36, 18, sun, 3 * distance, 0.0f, 1.0f, "Earth", true, "textures/earth.jpg");
-	std::shared_ptr<Sphere> moon = std::make_shared<Sphere>(.15, 36, 18, earth, .2 * distance, 0.0f, 2.0f, "Moon", false, "textures/moon.jpg");
-	std::shared_ptr<Sphere> mars = std::make_shared<Sphere>(.25, 36, 18, sun, 4 * distance, 0.0f, 0.5f, "Mars", false, "textures/mars.jpg");
-	std::shared_ptr<Sphere> jupiter = std::make_shared<Sphere>(1.2, 36, 18, sun, 5 * distance, 0.0f, 0.09f, "Jupiter", true, "textures/jupiter.jpg");
-	std::shared_ptr<Sphere> saturn = std::make_shared<Sphere>(1.0, 36, 18, sun, 6 * distance, 0.0f, 0.03f, "Saturn", true, "textures/saturn.jpg");
-	std::shared_ptr<Sphere> uranus = std::make_shared<Sphere>(.9, 36, 18, sun, 7 * distance, 0.0f, 0.01f, "Uranus", true, "textures/uranus.jpg");
-	std::shared_ptr<Sphere> neptune = std::make_shared<Sphere>(.8, 36, 18, sun, 8 * distance, 0.0f, 0.005f, "Neptune", true, "textures/neptune.jpg");
-
-	std::vector<std::shared_ptr<Sphere>> spheres;
-	spheres.push_back(sun);
-	spheres.push_back(mercury);
-	spheres.push_back(venus);
-	spheres.push_back(earth);
-	spheres.push_back(moon);
-	spheres.push_back(mars);
-	spheres.push_back(jupiter);
-	spheres.push_back(saturn);
-	spheres.push_back(uranus);
-	spheres.push_back(neptune);
+	// The help overlay is laid out once and only rebuilt when its text changes
+	std::unique_ptr<UiLayer> ui = std::make_unique<UiLayer>();
+	TextBlock& help = ui->AddBlock();
+	const glm::vec3 helpColor(0.7, 0.7f, 0.2f);
+	// Line 0 is the speed readout, set in the loop
+	const char* helpLines[HelpLineCount] = { "",
+		"Press <-/-> Arrow keys to speed up/down",
+		"Press Up/Down Arrow keys to change the time warp",
+		"Press PgUp/PgDn to jump 1000 years, Home to go back to year 0",
+		"Press G to toggle N-body gravity",
+		"Press F5 to save a checkpoint, F9 to go back to it",
+		"Press N to toogle planet name display",
+		"Press H to toogle help display" };
+	for (int line = 1; line < HelpLineCount; line++)
+		help.SetLine(line, helpLines[line], 25.0f, HelpLineY(line), 0.4f, helpColor);
+	float shownSpeed = -1.0f;
+	double shownWarp = 0.0;
+
+	// Orbits are resolved parent first whatever order the bodies are created or updated in
+	TransformHierarchy transforms;
+	// Orbital elements of all bodies, evaluated together by the SIMD Kepler solver
+	BodyStorage bodies;
+	// Every body is an entity, its data split over dense component pools
+	SceneRegistry registry;
+	// Small bodies are particles with their own orbits, far too many to be full bodies
+	ParticleSystem particles;
+
+	// Bodies and particle fields come from the scene file, compiled on first use
+	SceneFile scene;
+	if (!scene.Open(scenePath))
+	{
+		std::cout << "Failed to load scene " << scenePath << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	scene.Load(registry, transforms, bodies, particles);
+	uint64_t sceneHash = scene.SourceHash();
+	scene.Close();
+	std::cout << "Bodies: " << bodies.Size() << std::endl;
+	std::cout << "Particles: " << particles.Size() << std::endl;
 
+	MeshCache::ReportMemory(std::cout);
+
+	// From here on the bodies belong to the simulation thread, this one only draws its snapshots
+	Simulation sim(transforms, bodies, SimulatedYear, scenePath + ".checkpoint", sceneHash);
+	sim.Start();
+	simulation = &sim;
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
 
+		// Newest complete state, drawn one tick behind real time so it can be blended
+		const Snapshot& state = sim.Latest();
+		float alpha = sim.Alpha(state);
+
 		// Clear window
 		glClearColor(0.2f, 0.2f, 0.2f, 0.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		
-		// Draw
-		for (auto it : spheres) {
-			it->update(speedScale);
-			it->draw(*view, *projection);
-			if (displayNames)
-				it->drawText(*view, *projection, text);
+
+		if (windowResized) {
+			*projection = glm::perspective(glm::radians(45.0f), (GLfloat)WIDTH / (GLfloat)HEIGHT, 0.1f, 1000.0f);
+			screen = glm::ortho(0.0f, static_cast<GLfloat>(WIDTH), 0.0f, static_cast<GLfloat>(HEIGHT));
+			ui->Resize();
+			windowResized = false;
 		}
+
+		// Upload the camera once for the whole frame
+		camera->Update(*view, *projection, screen);
+
+		BodySystems::DrawBodies(registry, *renderer, state, alpha);
+		renderer->Flush();
+		particles.Draw(state, alpha);
+		if (displayNames)
+			BodySystems::DrawLabels(registry, *view, *projection, glm::vec2(WIDTH, HEIGHT), text, state, alpha);
+		// The speed readout is only formatted again when the speed changes
+		help.visible = displayHelp;
+		if (displayHelp && (state.speedScale != shownSpeed || state.timeWarp != shownWarp)) {
+			char speedtxt[48];
+			snprintf(speedtxt, sizeof(speedtxt), "Current speed: %.1f, time warp x%.0f", std::fabs(state.speedScale), state.timeWarp);
+			help.SetLine(0, speedtxt, 25.0f, HelpLineY(0), 0.4f, helpColor);
+			shownSpeed = state.speedScale;
+			shownWarp = state.timeWarp;
+		}
+		// The date changes every frame, it is queued with the other dynamic text
 		if (displayHelp) {
-			std::string speedtxt = std::to_string(speedScale);
-			if (speedtxt.size() > 0 && speedtxt.at(0) == '-')
-				speedtxt = speedtxt.substr(1, speedtxt.size());
-			if (speedtxt.size() > 3)
-				speedtxt = speedtxt.substr(0, 3);
-
-			text.Render(std::string("Current speed: " + speedtxt).c_str(), 25.0f, 85.0f, 0.4f, glm::vec3(0.7, 0.7f, 0.2f));
-			text.Render("Press <-/-> Arrow keys to speed up/down", 25.0f, 60.0f, 0.4f, glm::vec3(0.7, 0.7f, 0.2f));
-			text.Render("Press N to toogle planet name display", 25.0f, 35.0f, 0.4f, glm::vec3(0.7, 0.7f, 0.2f));
-			text.Render("Press H to toogle help display", 25.0f, 10.0f, 0.4f, glm::vec3(0.7, 0.7f, 0.2f));
+			char yeartxt[32];
+			snprintf(yeartxt, sizeof(yeartxt), "Year %.1f", state.Time(alpha) / SimulatedYear);
+			text.Render(yeartxt, 25.0f, HEIGHT - 40.0f, 0.4f, helpColor);
 		}
+		ui->Draw(text);
+
+		// All text of the frame goes out in one draw
+		text.Flush();
 
 		//Swap buffers
 		glfwSwapBuffers(window);
 	}
 
+	simulation = nullptr;
+	sim.Stop();
+
+	// Glyphs rasterised this run are reused by the next start
+	text.SaveCache();
+	ui.reset();
+	renderer.reset();
+	camera.reset();
+	MeshCache::Clear();
+	MaterialLibrary::Clear();
+	ShaderLibrary::Clear();
+	JobSystem::Shutdown();
+
 	glfwDestroyWindow(window);
 	glfwTerminate();
 }
\ No newline at end of file
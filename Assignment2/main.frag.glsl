@@ -1,12 +1,13 @@
 #version 330 core
 
 in vec2 TexCoords;
+flat in float Layer;
 
 out vec4 color;
 
-uniform sampler2D texture1;
+uniform sampler2DArray texture1;
 
 void main()
 {
-    color = texture(texture1, TexCoords);
+    color = texture(texture1, vec3(TexCoords, Layer));
 }
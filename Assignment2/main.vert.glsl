@@ -2,15 +2,23 @@
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec2 texCoord;
+// per instance
+layout (location = 2) in mat4 model;
+layout (location = 6) in float layer;
 
 out vec2 TexCoords;
+flat out float Layer;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 screen;
+};
 
 void main()
 {
     gl_Position = projection * view * model * vec4(position, 1.0f);
     TexCoords = vec2(texCoord.x, texCoord.y);
+    Layer = layer;
 }
@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec3 Color;
+
+out vec4 color;
+
+void main()
+{
+    // Round sprite, shaded as the front of a small sphere
+    vec2 p = gl_PointCoord * 2.0 - 1.0;
+    float d = dot(p, p);
+    if (d > 1.0)
+        discard;
+    color = vec4(Color * (0.4 + 0.6 * sqrt(1.0 - d)), 1.0);
+}
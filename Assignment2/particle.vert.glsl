@@ -0,0 +1,44 @@
+#version 330 core
+
+// <mean anomaly at t = 0, mean motion>, fixed point
+layout (location = 0) in uvec2 orbit;
+// <semi-major axis, eccentricity, periapsis, height>
+layout (location = 1) in vec4 elements;
+// <size, shade>
+layout (location = 2) in vec2 look;
+
+out vec3 Color;
+
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 screen;
+};
+
+// Turns of the base motion since t = 0, in 2^-32 turns
+uniform uint phase;
+// Position and orientation of the focus
+uniform mat4 frame;
+uniform vec3 color;
+
+const float TurnToRadians = 6.283185307 / 4294967296.0;
+
+void main()
+{
+    // Unsigned multiplication wraps around, which is exactly the reduction to one turn
+    float M = float(orbit.x + orbit.y * phase) * TurnToRadians;
+    // First order in the eccentricity is plenty for e < 0.1
+    float e = elements.y;
+    float angle = M + 2.0 * e * sin(M);
+    float r = elements.x * (1.0 - e * cos(M));
+    angle += elements.z;
+    vec4 viewPos = view * frame * vec4(r * cos(angle), elements.w * sin(M), r * sin(angle), 1.0);
+    gl_Position = projection * viewPos;
+
+    // Diameter in pixels, screen[1][1] being 2 / viewport height. Particles smaller than a
+    // pixel are drawn as one and dimmed by the area they miss.
+    float pixels = look.x * projection[1][1] / (screen[1][1] * -viewPos.z);
+    gl_PointSize = max(pixels, 1.0);
+    Color = color * look.y * min(pixels * pixels, 1.0);
+}
@@ -1,12 +1,15 @@
 #version 330 core
-in vec2 TexCoords;
+in vec3 TexCoords;
+in vec3 TextColor;
 out vec4 color;
 
-uniform sampler2D text;
-uniform vec3 textColor;
+uniform sampler2DArray text;
 
 void main()
 {
-    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-    color = vec4(textColor, 1.0) * sampled;
-}  
+    // Signed distance field: 0.5 is the glyph edge, smoothed over about one screen pixel
+    float distance = texture(text, TexCoords).r;
+    float width = max(fwidth(distance), 1e-4);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    color = vec4(TextColor, alpha);
+}
@@ -1,11 +1,20 @@
 #version 330 core
 layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
-out vec2 TexCoords;
+layout (location = 1) in vec4 colorScale; // <vec3 color, float scale>
+layout (location = 2) in float page; // atlas page of the glyph
+out vec3 TexCoords;
+out vec3 TextColor;
 
-uniform mat4 projection;
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 screen;
+};
 
 void main()
 {
-    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
-    TexCoords = vec2(vertex.z, 1.0f - vertex.w);
+    gl_Position = screen * vec4(vertex.xy, 0.0, 1.0);
+    TexCoords = vec3(vertex.zw, page);
+    TextColor = colorScale.rgb;
 }